@@ -1,8 +1,14 @@
 #include "testint.hpp"
 #include "matrix.hpp"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <numeric>
 #include <sstream>
 #include <string>
+#include <functional>
+#include <type_traits>
 
 using namespace std;
 using sjtu::Matrix;
@@ -76,6 +82,11 @@ std::pair<bool, std::string> resizeTest()
 	return { true, "Congratulation" };
 }
 
+// containers such as std::vector only move their elements when this holds
+static_assert(std::is_nothrow_move_assignable<Matrix<double>>::value, "Matrix move assignment must be noexcept");
+static_assert(std::is_nothrow_move_assignable<Matrix<int, sjtu::HugePageAllocator<int>>>::value,
+			  "Matrix move assignment must be noexcept");
+
 std::pair<bool, std::string> moveTest()
 {
 	const int N = 200, M = 300;
@@ -177,12 +188,323 @@ std::pair<bool, std::string> exceptionTest()
 	return { true, "Congratulation" };
 }
 
+std::pair<bool, std::string> lazyTest()
+{
+	const int N = 97, M = 131;
+	Matrix<int> a(N, M), b(N, M), c(N, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			a(i, j) = rand() % 1000, b(i, j) = rand() % 1000, c(i, j) = rand() % 1000;
+
+	Matrix<int> d = sjtu::lazy(a) + b - c * 2;
+	if (d != a + b - c * 2) return WA("lazy construct");
+
+	Matrix<int> e(1, 1);
+	e = -(sjtu::lazy(a) - b) * 3 + 2 * sjtu::lazy(c);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			if (e(i, j) != -(a(i, j) - b(i, j)) * 3 + 2 * c(i, j))
+				return WA("lazy assign");
+
+	e += sjtu::lazy(a) - b;
+	e -= sjtu::lazy(c) * 2;
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			if (e(i, j) != -(a(i, j) - b(i, j)) * 3 + a(i, j) - b(i, j))
+				return WA("lazy compound assign");
+
+	// every element of a is read before it is written, so aliasing the target is fine
+	Matrix<int> f = a;
+	f = sjtu::lazy(f) + b;
+	if (f != a + b) return WA("lazy alias");
+
+	Matrix<double> g = sjtu::lazy(a) * 0.5;
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			if (g(i, j) != a(i, j) * 0.5)
+				return WA("lazy scale to double");
+
+	int cnt = 0;
+	Matrix<int> h(M, N);
+	try
+	{
+		Matrix<int> t = sjtu::lazy(a) + h;
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		Matrix<int> t = sjtu::lazy(a) * 2 - sjtu::lazy(h);
+	} catch (std::invalid_argument &) { cnt++; }
+
+	if (cnt != 2) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> viewTest()
+{
+	const int N = 60, M = 45;
+	Matrix<int> a(N, M), b(M, N);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			a(i, j) = rand() % 100, b(j, i) = rand() % 100;
+	const Matrix<int> &ca = a;
+
+	sjtu::ConstMatrixView<int> s = ca.subView({ 10, 5 }, { 29, 24 });
+	if (s.rowLength() != 20 || s.columnLength() != 20 || s.stride() != M) return WA("subView shape");
+	for (size_t i = 0; i < 20; i++)
+		for (size_t j = 0; j < 20; j++)
+			if (s(i, j) != a(i + 10, j + 5))
+				return WA("subView element");
+	for (size_t j = 0; j < 20; j++)
+		if (s.row(3)(0, j) != a(13, j + 5) || s.column(4)(j, 0) != a(j + 10, 9))
+			return WA("subView row/column");
+	for (size_t j = 0; j < M; j++)
+		if (ca.rowView(7)(0, j) != a(7, j) || ca.columnView(j)(7, 0) != a(7, j))
+			return WA("row/column view");
+
+	// products of views agree with products of the copied blocks
+	sjtu::ConstMatrixView<int> p = ca.subView({ 0, 0 }, { 19, 29 });
+	sjtu::ConstMatrixView<int> q = b.view().subView({ 3, 7 }, { 32, 21 });
+	Matrix<int> pq = p * q;
+	if (pq != Matrix<int>(p) * Matrix<int>(q)) return WA("view product");
+	if (a.rowView(0) * b.columnView(0) != a.row(0) * b.column(0)) return WA("row times column view");
+	if (s + s != Matrix<int>(s) * 2) return WA("view sum");
+
+	// writes through a view land in the parent and nowhere else
+	Matrix<int> c = a;
+	sjtu::MatrixView<int> w = c.subView({ 10, 5 }, { 29, 24 });
+	w(0, 0) = -1;
+	w.row(1) *= 2;
+	w.column(2) += Matrix<int>(20, 1, 1);
+	w.subView({ 5, 5 }, { 9, 9 }).assign(Matrix<int>(5, 5, 7));
+	w.subView({ 15, 15 }, { 19, 19 }) -= s.subView({ 0, 0 }, { 4, 4 });
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+		{
+			int v = a(i, j);
+			if (i >= 10 && i <= 29 && j >= 5 && j <= 24)
+			{
+				size_t x = i - 10, y = j - 5;
+				if (x == 0 && y == 0) v = -1;
+				if (x == 1) v *= 2;
+				if (y == 2) v += 1;
+				if (x >= 5 && x <= 9 && y >= 5 && y <= 9) v = 7;
+				if (x >= 15 && y >= 15) v -= a(x - 15 + 10, y - 15 + 5);
+			}
+			if (c(i, j) != v) return WA("write through view");
+		}
+
+	int cnt = 0;
+	try
+	{
+		ca.subView({ 0, 0 }, { N, 0 });
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		ca.subView({ 5, 5 }, { 4, 6 });
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		s.row(20);
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		p * p;
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		w += p;
+	} catch (std::invalid_argument &) { cnt++; }
+
+	if (cnt != 5) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> transposeTest()
+{
+	// square and rectangular shapes, including ones that are not multiples of the tile size
+	const size_t shapes[][2] = {{ 1, 1 }, { 64, 64 }, { 67, 67 }, { 1, 40 }, { 40, 1 }, { 37, 53 }, { 53, 37 }, { 128, 2 }, { 300, 200 }};
+	for (auto &&s : shapes)
+	{
+		const size_t N = s[0], M = s[1];
+		Matrix<long long> a(N, M);
+		for (size_t i = 0; i < N; i++)
+			for (size_t j = 0; j < M; j++)
+				a(i, j) = (long long)rand() << 20 | (i * M + j);
+
+		Matrix<long long> t = a.tran();
+		if (t.rowLength() != M || t.columnLength() != N) return WA("tran shape");
+		for (size_t i = 0; i < N; i++)
+			for (size_t j = 0; j < M; j++)
+				if (t(j, i) != a(i, j))
+					return WA("tran " + toString(N) + "x" + toString(M));
+
+		Matrix<long long> b = a;
+		b.tranInPlace();
+		if (b != t) return WA("tranInPlace " + toString(N) + "x" + toString(M));
+		if (b.tranInPlace() != a) return WA("tranInPlace twice " + toString(N) + "x" + toString(M));
+	}
+
+	Matrix<testint> c(23, 41);
+	for (size_t i = 0; i < 23; i++)
+		for (size_t j = 0; j < 41; j++)
+			c(i, j) = testint(i * 41 + j);
+	c.tranInPlace();
+	for (size_t i = 0; i < 23; i++)
+		for (size_t j = 0; j < 41; j++)
+			if (c(j, i) != testint(i * 41 + j))
+				return WA("tranInPlace non-arithmetic type");
+
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> strassenTest()
+{
+	// small limits make odd sizes recurse several levels and peel an edge at each one
+	const size_t threshold = sjtu::getStrassenThreshold(), crossover = sjtu::getStrassenCrossover();
+	sjtu::setStrassenThreshold(16);
+	sjtu::setStrassenCrossover(8);
+	const size_t shapes[][3] = {{ 16, 16, 16 }, { 17, 17, 17 }, { 33, 31, 35 }, { 65, 63, 67 }, { 99, 101, 97 }, { 129, 17, 41 }};
+	std::pair<bool, std::string> result = { true, "Congratulation" };
+	for (auto &&s : shapes)
+	{
+		const size_t N = s[0], K = s[1], M = s[2];
+		Matrix<double> a(N, K), b(K, M), c(N, M);
+		for (size_t i = 0; i < N; i++)
+			for (size_t j = 0; j < K; j++)
+				a(i, j) = rand() % 2001 / 1000.0 - 1;
+		for (size_t i = 0; i < K; i++)
+			for (size_t j = 0; j < M; j++)
+				b(i, j) = rand() % 2001 / 1000.0 - 1;
+		for (size_t i = 0; i < N; i++)
+			for (size_t k = 0; k < K; k++)
+				for (size_t j = 0; j < M; j++)
+					c(i, j) += a(i, k) * b(k, j);
+
+		Matrix<double> automatic = a * b, strassen = sjtu::multiply(a, b, sjtu::MultiplyAlgorithm::Strassen);
+		Matrix<float> single = sjtu::multiply(Matrix<float>(a), Matrix<float>(b), sjtu::MultiplyAlgorithm::Strassen);
+		for (size_t i = 0; i < N; i++)
+			for (size_t j = 0; j < M; j++)
+				if (std::abs(automatic(i, j) - c(i, j)) > 1e-10 || std::abs(strassen(i, j) - c(i, j)) > 1e-10 ||
+					std::abs(single(i, j) - c(i, j)) > 1e-3)
+					result = WA("Strassen " + toString(N) + "x" + toString(K) + "x" + toString(M));
+		if (!result.first) break;
+	}
+	sjtu::setStrassenThreshold(threshold);
+	sjtu::setStrassenCrossover(crossover);
+	return result;
+}
+
+std::pair<bool, std::string> elementsTest()
+{
+	const int N = 31, M = 17;
+	Matrix<int> a(N, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			a(i, j) = rand() % 1000;
+	const Matrix<int> &ca = a;
+
+	auto r = a.elements();
+	if (r.size() != N * M || r.data() != a.data() || r.end() - r.begin() != N * M) return WA("range size");
+	static_assert(std::is_same<std::iterator_traits<decltype(r.begin())>::iterator_category,
+							   std::random_access_iterator_tag>::value, "elements() must be random access");
+	static_assert(std::is_same<decltype(*ca.elements().begin()), const int &>::value, "const elements() must be read-only");
+
+	long long sum = 0;
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			sum += a(i, j);
+	if (std::accumulate(ca.elements().begin(), ca.elements().end(), 0LL) != sum) return WA("accumulate");
+
+	auto it = r.begin();
+	if (it[M + 2] != a(1, 2) || *(it + 5 * M) != a(5, 0) || *(r.end() - 1) != a(N - 1, M - 1)) return WA("random access");
+	it += 3;
+	if (*it-- != a(0, 3) || *it != a(0, 2) || !(it < r.end()) || it >= r.end() || (2 + it) - it != 2) return WA("iterator arithmetic");
+
+	std::sort(r.begin(), r.end());
+	if (!std::is_sorted(ca.elements().begin(), ca.elements().end()) || std::accumulate(r.begin(), r.end(), 0LL) != sum)
+		return WA("sort");
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j + 1 < M; j++)
+			if (a(i, j) > a(i, j + 1)) return WA("sorted in row-major order");
+
+	std::fill(r.begin(), r.end(), 7);
+	for (auto &&x : ca.elements())
+		if (x != 7) return WA("fill");
+
+	Matrix<int> empty(0, 4);
+	if (empty.elements().size() != 0 || empty.elements().begin() != empty.elements().end()) return WA("empty range");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> rvalueTest()
+{
+	const int N = 50, M = 70;
+	Matrix<int> a(N, M), b(N, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			a(i, j) = rand() % 1000, b(i, j) = rand() % 1000;
+
+	// an expiring operand lends its buffer to the result
+	Matrix<int> x = a;
+	const int *p = x.data();
+	Matrix<int> c = std::move(x) + b;
+	if (c.data() != p) return WA("Matrix&& + Matrix reuses the buffer");
+	p = c.data();
+	c = std::move(c) - b * 2;
+	if (c.data() != p) return WA("Matrix&& - Matrix reuses the buffer");
+	c = 3 * std::move(c);
+	if (c.data() != p) return WA("scalar * Matrix&& reuses the buffer");
+	c = b - std::move(c);
+	if (c.data() != p) return WA("Matrix - Matrix&& reuses the buffer");
+	c = b + std::move(c) * 2;
+	if (c.data() != p) return WA("Matrix + Matrix&& reuses the buffer");
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			if (c(i, j) != b(i, j) + (b(i, j) - (a(i, j) - b(i, j)) * 3) * 2)
+				return WA("value of the chained expression");
+
+	Matrix<int> d = a + b - a * 2 + b * 3;
+	if (d != (a + b) - (a * 2) + (b * 3)) return WA("temporaries chained");
+
+	// a result of a wider type cannot live in the operand's buffer
+	Matrix<double> e = std::move(d) * 0.5;
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			if (e(i, j) != ((a(i, j) + b(i, j)) - a(i, j) * 2 + b(i, j) * 3) * 0.5)
+				return WA("widening product");
+
+	int cnt = 0;
+	try
+	{
+		Matrix<int> t = Matrix<int>(M, N) + a;
+	} catch (std::invalid_argument &) { cnt++; }
+
+	try
+	{
+		Matrix<int> t = a - Matrix<int>(M, N);
+	} catch (std::invalid_argument &) { cnt++; }
+
+	if (cnt != 2) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
 int main()
 {
 
 	std::pair<std::string, std::function<std::pair<bool, std::string>(void)>> testcases[] = {{ "resizeTest",    resizeTest },
 																							 { "moveTest",      moveTest },
-																							 { "exceptionTest", exceptionTest }};
+																							 { "exceptionTest", exceptionTest },
+																							 { "lazyTest",      lazyTest },
+																							 { "viewTest",      viewTest },
+																							 { "transposeTest", transposeTest },
+																							 { "strassenTest",  strassenTest },
+																							 { "elementsTest",  elementsTest },
+																							 { "rvalueTest",    rvalueTest }};
 
 	bool result;
 	std::string information;
@@ -0,0 +1,237 @@
+// Throughput benchmark for sjtu::Matrix, printed as JSON on stdout.
+//
+//   g++ -std=c++14 -O2 -pthread -I Matrix Benchmark.cpp -o bench && ./bench > matrix.json
+//   g++ -std=c++14 -O2 -DBENCH_STD Benchmark.cpp -o bench_std && ./bench_std > std.json
+//
+// BENCH_STD builds the same cases against the reference std.hpp, so the two files can be
+// compared entry by entry. Options: --quick (smaller sizes, for smoke runs) and
+// --threads=N (matrix.hpp only, see sjtu::setThreadCount).
+
+#include "testint.hpp"
+#ifdef BENCH_STD
+#include "std.hpp"
+#else
+#include "matrix.hpp"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using sjtu::Matrix;
+
+template <class T> struct TypeName;
+template <> struct TypeName<signed char> { static const char *get() { return "int8"; } };
+template <> struct TypeName<float> { static const char *get() { return "float"; } };
+template <> struct TypeName<int> { static const char *get() { return "int"; } };
+template <> struct TypeName<double> { static const char *get() { return "double"; } };
+template <> struct TypeName<testint> { static const char *get() { return "testint"; } };
+
+// keeps the optimizer from discarding a result nobody reads
+template <class T>
+void escape(const T &x)
+{
+#ifdef __GNUC__
+	asm volatile("" : : "g"(&x) : "memory");
+#else
+	static const volatile void *sink;
+	sink = &x;
+#endif
+}
+
+struct Result
+{
+	string name, type;
+	size_t rows, cols;
+	double seconds, flops, bytes;
+};
+
+vector<Result> results;
+bool quick = false;
+
+// Best wall time of fn over at least 3 runs and 0.2 seconds; setup runs untimed before each.
+double measure(const function<void()> &setup, const function<void()> &fn)
+{
+	double best = 1e100, total = 0;
+	for (int rep = 0; rep < 3 || (total < 0.2 && rep < 1000); rep++)
+	{
+		setup();
+		auto start = chrono::steady_clock::now();
+		fn();
+		double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		best = min(best, t);
+		total += t;
+	}
+	return best;
+}
+
+template <class T>
+void record(const string &name, size_t n, size_t m, double seconds, double flops, double bytes)
+{
+	results.push_back({ name, TypeName<T>::get(), n, m, seconds, flops, bytes });
+}
+
+template <class T>
+Matrix<T> filled(size_t n, size_t m)
+{
+	Matrix<T> a(n, m);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < m; j++)
+			a(i, j) = T(int((i * 31 + j * 7) % 17) - 8);
+	return a;
+}
+
+template <class T>
+void benchMemory(size_t n)
+{
+	const double bytes = double(n) * n * sizeof(T);
+	Matrix<T> a = filled<T>(n, n), b;
+
+	record<T>("construct", n, n, measure([] {}, [&] {
+		Matrix<T> c(n, n, T(1));
+		escape(c);
+	}), 0, bytes);
+
+	record<T>("copy", n, n, measure([] {}, [&] {
+		Matrix<T> c(a);
+		escape(c);
+	}), 0, 2 * bytes);
+
+	record<T>("move", n, n, measure([&] { b = a; }, [&] {
+		Matrix<T> c(std::move(b));
+		escape(c);
+	}), 0, 0);
+
+	record<T>("resize", n, n, measure([&] { b = a; }, [&] {
+		b.resize(n + 1, n);
+		escape(b);
+	}), 0, 2 * bytes);
+
+	record<T>("tran", n, n, measure([] {}, [&] {
+		Matrix<T> c = a.tran();
+		escape(c);
+	}), 0, 2 * bytes);
+
+	record<T>("add", n, n, measure([] {}, [&] {
+		Matrix<T> c = a + a;
+		escape(c);
+	}), double(n) * n, 3 * bytes);
+
+	record<T>("scale", n, n, measure([] {}, [&] {
+		auto c = a * T(3);
+		escape(c);
+	}), double(n) * n, 2 * bytes);
+
+	record<T>("iterate", n, n, measure([] {}, [&] {
+		T sum = T();
+		for (auto &&x : a)
+			sum += x;
+		escape(sum);
+	}), 0, bytes);
+
+	record<T>("submatrix", n / 2, n / 2, measure([] {}, [&] {
+		T sum = T();
+		auto range = a.subMatrix({ n / 4, n / 4 }, { n / 4 + n / 2 - 1, n / 4 + n / 2 - 1 });
+		for (auto it = range.first; it != range.second; ++it)
+			sum += *it;
+		escape(sum);
+	}), 0, bytes / 4);
+}
+
+template <class T>
+void benchMultiply(size_t n)
+{
+	Matrix<T> a = filled<T>(n, n), b = filled<T>(n, n);
+	record<T>("multiply", n, n, measure([] {}, [&] {
+		auto c = a * b;
+		escape(c);
+	}), 2.0 * n * n * n, 3.0 * n * n * sizeof(T));
+}
+
+#ifndef BENCH_STD
+// narrow operands, products accumulated in the wider Acc; "type" names the operands
+template <class Acc, class T>
+void benchMultiplyAs(size_t n)
+{
+	Matrix<T> a = filled<T>(n, n), b = filled<T>(n, n);
+	record<T>(string("multiply_as_") + TypeName<Acc>::get(), n, n, measure([] {}, [&] {
+		auto c = sjtu::multiplyAs<Acc>(a, b);
+		escape(c);
+	}), 2.0 * n * n * n, 2.0 * n * n * sizeof(T) + 1.0 * n * n * sizeof(Acc));
+}
+#endif
+
+void printJson(const char *implementation, size_t threads)
+{
+	printf("{\n  \"implementation\": \"%s\",\n  \"threads\": %zu,\n  \"results\": [\n", implementation, threads);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result &r = results[i];
+		printf("    {\"name\": \"%s\", \"type\": \"%s\", \"rows\": %zu, \"cols\": %zu, \"seconds\": %.9g, ",
+			   r.name.c_str(), r.type.c_str(), r.rows, r.cols, r.seconds);
+		if (r.flops > 0)
+			printf("\"gflops\": %.4g, ", r.flops / r.seconds / 1e9);
+		else
+			printf("\"gflops\": null, ");
+		if (r.bytes > 0)
+			printf("\"gbps\": %.4g}", r.bytes / r.seconds / 1e9);
+		else
+			printf("\"gbps\": null}");
+		printf(i + 1 < results.size() ? ",\n" : "\n");
+	}
+	printf("  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+	size_t threads = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+			quick = true;
+		else if (strncmp(argv[i], "--threads=", 10) == 0)
+			threads = strtoul(argv[i] + 10, nullptr, 10);
+		else
+		{
+			fprintf(stderr, "usage: %s [--quick] [--threads=N]\n", argv[0]);
+			return 1;
+		}
+	}
+#ifdef BENCH_STD
+	const char *implementation = "std.hpp";
+	threads = 1;
+#else
+	const char *implementation = "matrix.hpp";
+	sjtu::setThreadCount(threads);
+	threads = sjtu::getThreadCount();
+#endif
+
+	size_t memory = quick ? 256 : 2048;
+	benchMemory<int>(memory);
+	benchMemory<double>(memory);
+	benchMemory<testint>(quick ? 128 : 1024);
+
+	vector<size_t> sizes = quick ? vector<size_t>{ 32, 128 } : vector<size_t>{ 64, 256, 1024 };
+	for (size_t n : sizes)
+	{
+		benchMultiply<int>(n);
+		benchMultiply<double>(n);
+	}
+	for (size_t n : quick ? vector<size_t>{ 32 } : vector<size_t>{ 64, 256 })
+		benchMultiply<testint>(n);
+#ifndef BENCH_STD
+	for (size_t n : sizes)
+	{
+		benchMultiplyAs<int, signed char>(n);
+		benchMultiplyAs<double, float>(n);
+	}
+#endif
+
+	printJson(implementation, threads);
+	return 0;
+}
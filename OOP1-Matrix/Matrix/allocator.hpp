@@ -0,0 +1,261 @@
+//  allocator.hpp
+//  Storage allocators for sjtu::Matrix.
+
+#ifndef SJTU_ALLOCATOR_HPP
+#define SJTU_ALLOCATOR_HPP
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace sjtu
+{
+	namespace detail
+	{
+		inline void *aligned_malloc(size_t bytes, size_t align)
+		{
+			if(bytes == 0)
+				bytes = align;
+#if defined(_WIN32)
+			return _aligned_malloc(bytes, align);
+#else
+			void *p = nullptr;
+			if(posix_memalign(&p, align < sizeof(void *) ? sizeof(void *) : align, bytes) != 0)
+				return nullptr;
+			return p;
+#endif
+		}
+
+		inline void aligned_free(void *p) noexcept
+		{
+#if defined(_WIN32)
+			_aligned_free(p);
+#else
+			free(p);
+#endif
+		}
+
+		template <class T>
+		size_t checked_bytes(size_t n)
+		{
+			if(n > std::numeric_limits<size_t>::max() / sizeof(T))
+				throw std::bad_alloc();
+			return n * sizeof(T);
+		}
+	}
+
+	// The default Matrix allocator: every buffer starts on an Align-byte boundary
+	// (a cache line by default), so SIMD kernels never split a load across lines
+	// at the start of a row of a matrix whose width is a multiple of the vector size.
+	template <class T, size_t Align = 64>
+	class AlignedAllocator
+	{
+	public:
+		using value_type = T;
+		using is_always_equal = std::true_type;
+
+		template <class U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, Align>;
+		};
+
+		AlignedAllocator() noexcept = default;
+
+		template <class U>
+		AlignedAllocator(const AlignedAllocator<U, Align> &) noexcept {}
+
+		T *allocate(size_t n)
+		{
+			void *p = detail::aligned_malloc(detail::checked_bytes<T>(n), Align < alignof(T) ? alignof(T) : Align);
+			if(p == nullptr)
+				throw std::bad_alloc();
+			return static_cast<T *>(p);
+		}
+
+		void deallocate(T *p, size_t) noexcept
+		{
+			detail::aligned_free(p);
+		}
+
+		template <class U>
+		bool operator==(const AlignedAllocator<U, Align> &) const noexcept { return true; }
+
+		template <class U>
+		bool operator!=(const AlignedAllocator<U, Align> &) const noexcept { return false; }
+	};
+
+	// Buffers of at least 2 MiB are aligned to 2 MiB and, on Linux, marked for transparent
+	// huge pages, which removes most TLB misses when streaming through very large matrices.
+	template <class T>
+	class HugePageAllocator
+	{
+	public:
+		using value_type = T;
+		using is_always_equal = std::true_type;
+
+		static const size_t huge_page = size_t(2) << 20;
+
+		HugePageAllocator() noexcept = default;
+
+		template <class U>
+		HugePageAllocator(const HugePageAllocator<U> &) noexcept {}
+
+		T *allocate(size_t n)
+		{
+			size_t bytes = detail::checked_bytes<T>(n);
+			bool huge = bytes >= huge_page;
+			void *p = detail::aligned_malloc(huge ? (bytes + huge_page - 1) / huge_page * huge_page : bytes,
+											 huge ? huge_page : 64);
+			if(p == nullptr)
+				throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+			if(huge)
+				madvise(p, (bytes + huge_page - 1) / huge_page * huge_page, MADV_HUGEPAGE);
+#endif
+			return static_cast<T *>(p);
+		}
+
+		void deallocate(T *p, size_t) noexcept
+		{
+			detail::aligned_free(p);
+		}
+
+		template <class U>
+		bool operator==(const HugePageAllocator<U> &) const noexcept { return true; }
+
+		template <class U>
+		bool operator!=(const HugePageAllocator<U> &) const noexcept { return false; }
+	};
+
+	// A cache of freed 64-byte aligned blocks keyed by their exact size. Loops that keep
+	// creating and dropping temporaries of the same shape get their buffers back from
+	// here instead of from malloc. Thread-safe; holds at most `limit` idle bytes.
+	class MatrixPool
+	{
+	private:
+		std::mutex mtx;
+		std::unordered_map<size_t, std::vector<void *>> idle;
+		size_t idle_bytes = 0;
+		size_t limit;
+
+	public:
+		explicit MatrixPool(size_t limit = size_t(256) << 20): limit(limit) {}
+
+		MatrixPool(const MatrixPool &) = delete;
+
+		MatrixPool &operator=(const MatrixPool &) = delete;
+
+		~MatrixPool()
+		{
+			release();
+		}
+
+		static MatrixPool &global()
+		{
+			static MatrixPool pool;
+			return pool;
+		}
+
+		void *acquire(size_t bytes)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				auto it = idle.find(bytes);
+				if(it != idle.end() && !it->second.empty())
+				{
+					void *p = it->second.back();
+					it->second.pop_back();
+					idle_bytes -= bytes;
+					return p;
+				}
+			}
+			void *p = detail::aligned_malloc(bytes, 64);
+			if(p == nullptr)
+				throw std::bad_alloc();
+			return p;
+		}
+
+		void recycle(void *p, size_t bytes) noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if(idle_bytes + bytes <= limit)
+				{
+					try
+					{
+						idle[bytes].push_back(p);
+						idle_bytes += bytes;
+						return;
+					}
+					catch(...) {}
+				}
+			}
+			detail::aligned_free(p);
+		}
+
+		// frees every cached block
+		void release() noexcept
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			for(auto &bucket : idle)
+				for(void *p : bucket.second)
+					detail::aligned_free(p);
+			idle.clear();
+			idle_bytes = 0;
+		}
+
+		size_t idleBytes()
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			return idle_bytes;
+		}
+	};
+
+	template <class T>
+	class PoolAllocator
+	{
+		template <class> friend class PoolAllocator;
+
+	private:
+		MatrixPool *pool;
+
+	public:
+		using value_type = T;
+
+		PoolAllocator() noexcept: pool(&MatrixPool::global()) {}
+
+		explicit PoolAllocator(MatrixPool &pool) noexcept: pool(&pool) {}
+
+		template <class U>
+		PoolAllocator(const PoolAllocator<U> &o) noexcept: pool(o.pool) {}
+
+		T *allocate(size_t n)
+		{
+			return static_cast<T *>(pool->acquire(detail::checked_bytes<T>(n)));
+		}
+
+		void deallocate(T *p, size_t n) noexcept
+		{
+			pool->recycle(p, n * sizeof(T));
+		}
+
+		template <class U>
+		bool operator==(const PoolAllocator<U> &o) const noexcept { return pool == o.pool; }
+
+		template <class U>
+		bool operator!=(const PoolAllocator<U> &o) const noexcept { return pool != o.pool; }
+	};
+}
+
+#endif //SJTU_ALLOCATOR_HPP
@@ -0,0 +1,257 @@
+//  fixed_matrix.hpp
+//  Matrices whose shape is known at compile time, stored inline without heap allocation.
+
+#ifndef SJTU_FIXED_MATRIX_HPP
+#define SJTU_FIXED_MATRIX_HPP
+#include "matrix.hpp"
+#include <utility>
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// sum over k < K of a[k] * b[k * ldb], expanded at compile time
+		template <size_t K>
+		struct fixed_dot
+		{
+			template <class R, class U, class V>
+			static R apply(const U *a, const V *b, size_t ldb)
+			{
+				return fixed_dot<K - 1>::template apply<R>(a, b, ldb) + a[K - 1] * b[(K - 1) * ldb];
+			}
+		};
+
+		template <>
+		struct fixed_dot<1>
+		{
+			template <class R, class U, class V>
+			static R apply(const U *a, const V *b, size_t)
+			{
+				return a[0] * b[0];
+			}
+		};
+
+		// Expands a statement over every index in the pack; used instead of a runtime loop.
+		template <class F, size_t... I>
+		void fixed_for(const F &f, std::index_sequence<I...>)
+		{
+			int expand[] = {(f(I), 0)...};
+			(void)expand;
+		}
+	}
+
+	// An R x C matrix held by value. Shapes are template arguments, so mismatched
+	// products and sums are rejected at compile time and every kernel is unrolled.
+	template <class T, size_t R, size_t C>
+	class FixedMatrix
+	{
+		static_assert(R > 0 && C > 0, "FixedMatrix needs at least one row and one column");
+
+		template <class, size_t, size_t> friend class FixedMatrix;
+
+	private:
+		T elem[R * C];
+
+		template <class F>
+		void forEach(const F &f)
+		{
+			detail::fixed_for(f, std::make_index_sequence<R * C>());
+		}
+
+	public:
+		using value_type = T;
+
+		static constexpr size_t rows = R;
+		static constexpr size_t columns = C;
+
+		FixedMatrix(): elem() {}
+
+		explicit FixedMatrix(const T &_init)
+		{
+			forEach([&](size_t k) { elem[k] = _init; });
+		}
+
+		FixedMatrix(std::initializer_list<std::initializer_list<T>> il)
+		{
+			if(il.size() != R)
+				throw std::invalid_argument("invalid initializer_list");
+			size_t k = 0;
+			for(auto &i : il)
+			{
+				if(i.size() != C)
+					throw std::invalid_argument("invalid initializer_list");
+				for(auto &j : i)
+					elem[k++] = j;
+			}
+		}
+
+		template <class U>
+		FixedMatrix(const FixedMatrix<U, R, C> &o)
+		{
+			forEach([&](size_t k) { elem[k] = (T)o.elem[k]; });
+		}
+
+		template <class U>
+		explicit FixedMatrix(const ConstMatrixView<U> &o)
+		{
+			if(o.rowLength() != R || o.columnLength() != C)
+				throw std::invalid_argument("Size cannot match");
+			forEach([&](size_t k) { elem[k] = (T)o.data()[k / C * o.stride() + k % C]; });
+		}
+
+		template <class U, class A>
+		explicit FixedMatrix(const Matrix<U, A> &o): FixedMatrix(o.view()) {}
+
+		const T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, R, C);
+			return elem[C * i + j];
+		}
+
+		T &operator()(size_t i, size_t j) noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, R, C);
+			return elem[C * i + j];
+		}
+
+		const T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, R, C);
+			return elem[C * i + j];
+		}
+
+		T &at(size_t i, size_t j)
+		{
+			detail::check_index(i, j, R, C);
+			return elem[C * i + j];
+		}
+
+		static constexpr size_t rowLength() { return R; }
+
+		static constexpr size_t columnLength() { return C; }
+
+		static constexpr std::pair<size_t, size_t> size() { return std::pair<size_t, size_t>(R, C); }
+
+		T *data() { return elem; }
+
+		const T *data() const { return elem; }
+
+		MatrixView<T> view() { return MatrixView<T>(elem, R, C, C); }
+
+		ConstMatrixView<T> view() const { return ConstMatrixView<T>(elem, R, C, C); }
+
+		FixedMatrix<T, C, R> tran() const
+		{
+			FixedMatrix<T, C, R> tmp;
+			detail::fixed_for([&](size_t k) { tmp.elem[k % C * R + k / C] = elem[k]; }, std::make_index_sequence<R * C>());
+			return tmp;
+		}
+
+		template <class U>
+		bool operator==(const FixedMatrix<U, R, C> &o) const
+		{
+			for(size_t k = 0; k < R * C; k++)
+				if(elem[k] != o.elem[k])
+					return false;
+			return true;
+		}
+
+		template <class U>
+		bool operator!=(const FixedMatrix<U, R, C> &o) const
+		{
+			return !(*this == o);
+		}
+
+		template <class U>
+		FixedMatrix &operator+=(const FixedMatrix<U, R, C> &o)
+		{
+			forEach([&](size_t k) { elem[k] += (T)o.elem[k]; });
+			return *this;
+		}
+
+		template <class U>
+		FixedMatrix &operator-=(const FixedMatrix<U, R, C> &o)
+		{
+			forEach([&](size_t k) { elem[k] -= (T)o.elem[k]; });
+			return *this;
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		FixedMatrix &operator*=(const U &x)
+		{
+			forEach([&](size_t k) { elem[k] *= (T)x; });
+			return *this;
+		}
+
+		FixedMatrix operator-() const
+		{
+			FixedMatrix tmp;
+			detail::fixed_for([&](size_t k) { tmp.elem[k] = -elem[k]; }, std::make_index_sequence<R * C>());
+			return tmp;
+		}
+
+		template <class U, class V, size_t N, size_t K, size_t M>
+		friend FixedMatrix<decltype(U() * V()), N, M> operator*(const FixedMatrix<U, N, K> &a, const FixedMatrix<V, K, M> &b);
+	};
+
+	template <class T, size_t R, size_t C>
+	constexpr size_t FixedMatrix<T, R, C>::rows;
+
+	template <class T, size_t R, size_t C>
+	constexpr size_t FixedMatrix<T, R, C>::columns;
+
+	template <class U, class V, size_t N, size_t K, size_t M>
+	FixedMatrix<decltype(U() * V()), N, M> operator*(const FixedMatrix<U, N, K> &a, const FixedMatrix<V, K, M> &b)
+	{
+		typedef decltype(U() * V()) R;
+		FixedMatrix<R, N, M> tmp;
+		detail::fixed_for([&](size_t k) {
+			tmp.elem[k] = detail::fixed_dot<K>::template apply<R>(a.elem + k / M * K, b.elem + k % M, M);
+		}, std::make_index_sequence<N * M>());
+		return tmp;
+	}
+
+	// Catches products whose inner dimensions differ with a readable message.
+	template <class U, class V, size_t N, size_t K1, size_t K2, size_t M,
+			  class = typename std::enable_if<K1 != K2>::type>
+	void operator*(const FixedMatrix<U, N, K1> &, const FixedMatrix<V, K2, M> &)
+	{
+		static_assert(K1 == K2, "Size cannot match");
+	}
+
+	template <class U, class V, size_t N1, size_t M1, size_t N2, size_t M2>
+	FixedMatrix<decltype(U() * V()), N1, M1> operator+(const FixedMatrix<U, N1, M1> &a, const FixedMatrix<V, N2, M2> &b)
+	{
+		static_assert(N1 == N2 && M1 == M2, "Size cannot match");
+		FixedMatrix<decltype(U() * V()), N1, M1> tmp(a);
+		tmp += b;
+		return tmp;
+	}
+
+	template <class U, class V, size_t N1, size_t M1, size_t N2, size_t M2>
+	FixedMatrix<decltype(U() * V()), N1, M1> operator-(const FixedMatrix<U, N1, M1> &a, const FixedMatrix<V, N2, M2> &b)
+	{
+		static_assert(N1 == N2 && M1 == M2, "Size cannot match");
+		FixedMatrix<decltype(U() * V()), N1, M1> tmp(a);
+		tmp -= b;
+		return tmp;
+	}
+
+	template <class T, size_t N, size_t M, class U, class = detail::enable_scalar<U>>
+	FixedMatrix<decltype(T() * U()), N, M> operator*(const FixedMatrix<T, N, M> &a, const U &x)
+	{
+		FixedMatrix<decltype(T() * U()), N, M> tmp(a);
+		tmp *= x;
+		return tmp;
+	}
+
+	template <class T, size_t N, size_t M, class U, class = detail::enable_scalar<U>>
+	FixedMatrix<decltype(T() * U()), N, M> operator*(const U &x, const FixedMatrix<T, N, M> &a)
+	{
+		return a * x;
+	}
+}
+
+#endif //SJTU_FIXED_MATRIX_HPP
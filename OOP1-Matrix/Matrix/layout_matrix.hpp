@@ -0,0 +1,410 @@
+//  layout_matrix.hpp
+//  Dense matrices stored column-major or in Z-ordered tiles, convertible to and from Matrix.
+
+#ifndef SJTU_LAYOUT_MATRIX_HPP
+#define SJTU_LAYOUT_MATRIX_HPP
+#include "matrix.hpp"
+#include <cstdint>
+#include <utility>
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// side of a Layout::Tiled tile; a tile of doubles is 8 KiB and fits in L1
+		const size_t layout_tile = 32;
+
+		// interleaves the bits of i and j (i taking the higher bit of each pair)
+		inline uint64_t morton(uint32_t i, uint32_t j)
+		{
+			uint64_t code = 0;
+			for(int bit = 0; bit < 32; bit++)
+				code |= (uint64_t)((i >> bit) & 1) << (2 * bit + 1) | (uint64_t)((j >> bit) & 1) << (2 * bit);
+			return code;
+		}
+	}
+
+	// A rows x columns matrix in the storage order L (see Layout). Element access, conversion
+	// to and from Matrix and between layouts, transpose and products are provided; products
+	// pack RowMajor and ColMajor operands straight from their storage, with no conversion.
+	template <class T, Layout L>
+	class LayoutMatrix
+	{
+		template <class, Layout> friend class LayoutMatrix;
+
+	private:
+		static const size_t TB = detail::layout_tile;
+
+		size_t row_size = 0, col_size = 0;
+		std::vector<T, AlignedAllocator<T>> elem;
+		// Tiled only: offset of tile (ti, tj) in elem, at tile_start[ti * tileCols() + tj]
+		std::vector<size_t> tile_start;
+
+		size_t tileRows() const { return (row_size + TB - 1) / TB; }
+
+		size_t tileCols() const { return (col_size + TB - 1) / TB; }
+
+		// Sets the shape and sizes the storage. Tiles are numbered by sorting their Morton
+		// codes, so the order stays Z-shaped without padding the grid to a power of two;
+		// only the edge tiles carry padding.
+		void shape(size_t n, size_t m, const T &x)
+		{
+			row_size = n;
+			col_size = m;
+			if(L != Layout::Tiled)
+			{
+				elem.assign(n * m, x);
+				return;
+			}
+			size_t tr = tileRows(), tc = tileCols();
+			std::vector<std::pair<uint64_t, size_t>> order(tr * tc);
+			for(size_t t = 0; t < tr * tc; t++)
+				order[t] = std::make_pair(detail::morton((uint32_t)(t / tc), (uint32_t)(t % tc)), t);
+			std::sort(order.begin(), order.end());
+			tile_start.assign(tr * tc, 0);
+			for(size_t r = 0; r < order.size(); r++)
+				tile_start[order[r].second] = r * TB * TB;
+			elem.assign(tr * tc * TB * TB, x);
+		}
+
+		size_t index(size_t i, size_t j) const
+		{
+			if(L == Layout::RowMajor)
+				return i * col_size + j;
+			if(L == Layout::ColMajor)
+				return j * row_size + i;
+			return tile_start[i / TB * tileCols() + j / TB] + i % TB * TB + j % TB;
+		}
+
+		// Fills *this from the row-major n x m array src with leading dimension lds.
+		template <class U>
+		void assignRows(const U *src, size_t lds)
+		{
+			if(L == Layout::ColMajor && std::is_same<T, U>::value)
+			{
+				detail::parallel_transpose(row_size, col_size, (const T *)src, lds, elem.data(), row_size);
+				return;
+			}
+			if(L == Layout::Tiled)
+			{
+				forEachTile([&](size_t i0, size_t j0, size_t h, size_t w, T *tile) {
+					for(size_t i = 0; i < h; i++)
+						for(size_t j = 0; j < w; j++)
+							tile[i * TB + j] = (T)src[(i0 + i) * lds + j0 + j];
+				});
+				return;
+			}
+			detail::parallel_for(row_size, std::max(size_t(1), detail::parallel_grain / std::max(col_size, size_t(1))), [&](size_t lo, size_t hi) {
+				for(size_t i = lo; i < hi; i++)
+					for(size_t j = 0; j < col_size; j++)
+						elem[index(i, j)] = (T)src[i * lds + j];
+			});
+		}
+
+		// f(first row, first column, rows, columns, storage) for every tile, in parallel
+		template <class F>
+		void forEachTile(const F &f)
+		{
+			const size_t tb = TB, tc = tileCols();
+			detail::parallel_for(tileRows() * tc, std::max(size_t(1), detail::parallel_grain / (tb * tb)), [&](size_t lo, size_t hi) {
+				for(size_t t = lo; t < hi; t++)
+				{
+					size_t i0 = t / tc * tb, j0 = t % tc * tb;
+					f(i0, j0, std::min(tb, row_size - i0), std::min(tb, col_size - j0), elem.data() + tile_start[t]);
+				}
+			});
+		}
+
+		template <class F>
+		void forEachTile(const F &f) const
+		{
+			const_cast<LayoutMatrix *>(this)->forEachTile([&](size_t i0, size_t j0, size_t h, size_t w, const T *tile) {
+				f(i0, j0, h, w, tile);
+			});
+		}
+
+	public:
+		using value_type = T;
+
+		LayoutMatrix() = default;
+
+		LayoutMatrix(size_t n, size_t m, T _init = T())
+		{
+			shape(n, m, _init);
+		}
+
+		template <class U, class A>
+		explicit LayoutMatrix(const Matrix<U, A> &o)
+		{
+			shape(o.rowLength(), o.columnLength(), T());
+			assignRows(o.data(), o.columnLength());
+		}
+
+		// Row-major and column-major storage are each other's transposes, so converting
+		// between them is one cache-oblivious transpose; tiled conversions copy tile by tile.
+		template <class U, Layout L2>
+		explicit LayoutMatrix(const LayoutMatrix<U, L2> &o)
+		{
+			shape(o.row_size, o.col_size, T());
+			if(L2 == Layout::RowMajor)
+				assignRows(o.elem.data(), o.col_size);
+			else if(L == Layout::RowMajor)
+				o.copyRows(elem.data(), col_size);
+			else
+			{
+				Matrix<U> tmp(o);
+				assignRows(tmp.data(), col_size);
+			}
+		}
+
+		static Layout layout() { return L; }
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::make_pair(row_size, col_size); }
+
+		const T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return elem[index(i, j)];
+		}
+
+		T &operator()(size_t i, size_t j) noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return elem[index(i, j)];
+		}
+
+		const T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem[index(i, j)];
+		}
+
+		T &at(size_t i, size_t j)
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem[index(i, j)];
+		}
+
+		// The storage in layout order. For RowMajor and ColMajor, element (i, j) is
+		// data()[i * rowStride() + j * colStride()].
+		T *data() { return elem.data(); }
+
+		const T *data() const { return elem.data(); }
+
+		size_t rowStride() const { return L == Layout::ColMajor ? 1 : col_size; }
+
+		size_t colStride() const { return L == Layout::ColMajor ? row_size : 1; }
+
+		// Writes the matrix into the row-major array dst with leading dimension ldd.
+		template <class U>
+		void copyRows(U *dst, size_t ldd) const
+		{
+			if(L == Layout::ColMajor && std::is_same<T, U>::value)
+			{
+				detail::parallel_transpose(col_size, row_size, elem.data(), row_size, (T *)dst, ldd);
+				return;
+			}
+			if(L == Layout::Tiled)
+			{
+				forEachTile([&](size_t i0, size_t j0, size_t h, size_t w, const T *tile) {
+					for(size_t i = 0; i < h; i++)
+						for(size_t j = 0; j < w; j++)
+							dst[(i0 + i) * ldd + j0 + j] = (U)tile[i * TB + j];
+				});
+				return;
+			}
+			detail::parallel_for(row_size, std::max(size_t(1), detail::parallel_grain / std::max(col_size, size_t(1))), [&](size_t lo, size_t hi) {
+				for(size_t i = lo; i < hi; i++)
+					for(size_t j = 0; j < col_size; j++)
+						dst[i * ldd + j] = (U)elem[index(i, j)];
+			});
+		}
+
+		Matrix<T> row(size_t i) const
+		{
+			if(!(i < row_size))
+				throw std::invalid_argument("Out of range");
+			Matrix<T> tmp(1, col_size);
+			for(size_t j = 0; j < col_size; j++)
+				tmp(0, j) = elem[index(i, j)];
+			return tmp;
+		}
+
+		Matrix<T> column(size_t j) const
+		{
+			if(!(j < col_size))
+				throw std::invalid_argument("Out of range");
+			Matrix<T> tmp(row_size, 1);
+			for(size_t i = 0; i < row_size; i++)
+				tmp(i, 0) = elem[index(i, j)];
+			return tmp;
+		}
+
+		// The transpose in the same layout: one strided transpose of the whole storage,
+		// or for Tiled, each tile transposed into its mirror position.
+		LayoutMatrix tran() const
+		{
+			LayoutMatrix tmp(col_size, row_size);
+			if(L == Layout::RowMajor)
+				detail::parallel_transpose(row_size, col_size, elem.data(), col_size, tmp.elem.data(), row_size);
+			else if(L == Layout::ColMajor)
+				detail::parallel_transpose(col_size, row_size, elem.data(), row_size, tmp.elem.data(), col_size);
+			else
+			{
+				size_t tc = tileCols(), tr = tileRows();
+				detail::parallel_for(tr * tc, std::max(size_t(1), detail::parallel_grain / (TB * TB)), [&](size_t lo, size_t hi) {
+					for(size_t t = lo; t < hi; t++)
+						detail::transpose(TB, TB, elem.data() + tile_start[t], TB,
+										  tmp.elem.data() + tmp.tile_start[t % tc * tr + t / tc], TB);
+				});
+			}
+			return tmp;
+		}
+
+		template <class U>
+		bool operator==(const LayoutMatrix<U, L> &o) const
+		{
+			if(row_size != o.row_size || col_size != o.col_size)
+				return false;
+			if(L != Layout::Tiled)
+			{
+				for(size_t k = 0; k < elem.size(); k++)
+					if(elem[k] != o.elem[k])
+						return false;
+				return true;
+			}
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					if(elem[index(i, j)] != o.elem[index(i, j)])
+						return false;
+			return true;
+		}
+
+		template <class U>
+		bool operator!=(const LayoutMatrix<U, L> &o) const
+		{
+			return !(*this == o);
+		}
+
+		LayoutMatrix &operator+=(const LayoutMatrix &o)
+		{
+			if(row_size != o.row_size || col_size != o.col_size)
+				throw std::invalid_argument("Size cannot match");
+			detail::parallel_elementwise<detail::ew_add>(elem.data(), elem.data(), o.elem.data(), elem.size());
+			return *this;
+		}
+
+		LayoutMatrix &operator-=(const LayoutMatrix &o)
+		{
+			if(row_size != o.row_size || col_size != o.col_size)
+				throw std::invalid_argument("Size cannot match");
+			detail::parallel_elementwise<detail::ew_sub>(elem.data(), elem.data(), o.elem.data(), elem.size());
+			return *this;
+		}
+
+		friend LayoutMatrix operator+(LayoutMatrix a, const LayoutMatrix &b)
+		{
+			a += b;
+			return a;
+		}
+
+		friend LayoutMatrix operator-(LayoutMatrix a, const LayoutMatrix &b)
+		{
+			a -= b;
+			return a;
+		}
+	};
+
+	namespace detail
+	{
+		// A multiply operand as a pointer and strides; tiled operands are copied row-major into scratch first.
+		template <class T, Layout L>
+		const T *layout_operand(const LayoutMatrix<T, L> &x, Matrix<T> &scratch, size_t &rs, size_t &cs)
+		{
+			if(L != Layout::Tiled)
+			{
+				rs = x.rowStride();
+				cs = x.colStride();
+				return x.data();
+			}
+			scratch = Matrix<T>(x);
+			rs = x.columnLength();
+			cs = 1;
+			return scratch.data();
+		}
+	}
+
+	// a * b in a's layout. Any mix of RowMajor and ColMajor operands is fed to the packed
+	// GEMM through strides; a ColMajor result is computed as the row-major (b^T a^T).
+	template <class U, Layout LA, class V, Layout LB>
+	LayoutMatrix<decltype(U() * V()), LA> multiply(const LayoutMatrix<U, LA> &a, const LayoutMatrix<V, LB> &b)
+	{
+		typedef decltype(U() * V()) R;
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		size_t n = a.rowLength(), k = a.columnLength(), m = b.columnLength();
+		Matrix<U> sa;
+		Matrix<V> sb;
+		size_t ars, acs, brs, bcs;
+		const U *pa = detail::layout_operand(a, sa, ars, acs);
+		const V *pb = detail::layout_operand(b, sb, brs, bcs);
+		LayoutMatrix<R, LA> c(n, m);
+		if(LA == Layout::RowMajor)
+			detail::parallel_gemm(n, m, k, pa, ars, acs, pb, brs, bcs, c.data(), m);
+		else if(LA == Layout::ColMajor)
+			detail::parallel_gemm(m, n, k, pb, bcs, brs, pa, acs, ars, c.data(), n);
+		else
+		{
+			Matrix<R> tmp(n, m);
+			detail::parallel_gemm(n, m, k, pa, ars, acs, pb, brs, bcs, tmp.data(), m);
+			c = LayoutMatrix<R, LA>(tmp);
+		}
+		return c;
+	}
+
+	template <class U, Layout LA, class V, Layout LB>
+	LayoutMatrix<decltype(U() * V()), LA> operator*(const LayoutMatrix<U, LA> &a, const LayoutMatrix<V, LB> &b)
+	{
+		return multiply(a, b);
+	}
+
+	// dense * LayoutMatrix and LayoutMatrix * dense, as a dense Matrix; the LayoutMatrix
+	// operand is packed straight from its storage unless it is tiled
+	template <class U, class A, class V, Layout LB>
+	Matrix<decltype(U() * V())> operator*(const Matrix<U, A> &a, const LayoutMatrix<V, LB> &b)
+	{
+		typedef decltype(U() * V()) R;
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		size_t n = a.rowLength(), k = a.columnLength(), m = b.columnLength();
+		Matrix<V> sb;
+		size_t brs, bcs;
+		const V *pb = detail::layout_operand(b, sb, brs, bcs);
+		Matrix<R> c(n, m);
+		detail::parallel_gemm(n, m, k, a.data(), k, size_t(1), pb, brs, bcs, c.data(), m);
+		return c;
+	}
+
+	template <class U, Layout LA, class V, class B>
+	Matrix<decltype(U() * V())> operator*(const LayoutMatrix<U, LA> &a, const Matrix<V, B> &b)
+	{
+		typedef decltype(U() * V()) R;
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		size_t n = a.rowLength(), k = a.columnLength(), m = b.columnLength();
+		Matrix<U> sa;
+		size_t ars, acs;
+		const U *pa = detail::layout_operand(a, sa, ars, acs);
+		Matrix<R> c(n, m);
+		detail::parallel_gemm(n, m, k, pa, ars, acs, b.data(), m, size_t(1), c.data(), m);
+		return c;
+	}
+}
+
+#endif //SJTU_LAYOUT_MATRIX_HPP
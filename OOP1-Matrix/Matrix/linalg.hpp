@@ -0,0 +1,464 @@
+//  linalg.hpp
+//  Dense factorizations (LU, Cholesky, QR) and linear solves on sjtu::Matrix.
+
+#ifndef SJTU_LINALG_HPP
+#define SJTU_LINALG_HPP
+#include "matrix.hpp"
+#include <cmath>
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// Columns per panel. The panels are factored one column at a time; everything right of
+		// (and below) a panel is updated with one large gemm per panel, which does almost all the work.
+		const size_t factor_block = 64;
+
+		// c (rows x cols, ldc) -= a (rows x k, lda) * b (k x cols, ldb) through the packed gemm
+		template <class T>
+		void gemm_sub(size_t rows, size_t cols, size_t k, const T *a, size_t lda, const T *b, size_t ldb, T *c, size_t ldc)
+		{
+			if(rows == 0 || cols == 0 || k == 0)
+				return;
+			std::vector<T> neg(rows * k);
+			for(size_t i = 0; i < rows; i++)
+				for(size_t p = 0; p < k; p++)
+					neg[i * k + p] = -a[i * lda + p];
+			parallel_gemm(rows, cols, k, neg.data(), k, b, ldb, c, ldc);
+		}
+
+		// b (n x m) = L^-1 b for the lower triangle L of a (n x n); unit diagonal when unit is set
+		template <class T>
+		void solve_lower(size_t n, const T *a, size_t lda, bool unit, size_t m, T *b, size_t ldb)
+		{
+			for(size_t i = 0; i < n; i++)
+			{
+				T *bi = b + i * ldb;
+				for(size_t k = 0; k < i; k++)
+				{
+					T x = a[i * lda + k];
+					const T *bk = b + k * ldb;
+					for(size_t j = 0; j < m; j++)
+						bi[j] -= x * bk[j];
+				}
+				if(!unit)
+					for(size_t j = 0; j < m; j++)
+						bi[j] /= a[i * lda + i];
+			}
+		}
+
+		// b (n x m) = U^-1 b for the upper triangle U of a (n x n)
+		template <class T>
+		void solve_upper(size_t n, const T *a, size_t lda, size_t m, T *b, size_t ldb)
+		{
+			for(size_t i = n; i-- > 0;)
+			{
+				T *bi = b + i * ldb;
+				for(size_t k = i + 1; k < n; k++)
+				{
+					T x = a[i * lda + k];
+					const T *bk = b + k * ldb;
+					for(size_t j = 0; j < m; j++)
+						bi[j] -= x * bk[j];
+				}
+				for(size_t j = 0; j < m; j++)
+					bi[j] /= a[i * lda + i];
+			}
+		}
+
+		template <class T, class A>
+		Matrix<T> square_copy(const Matrix<T, A> &a)
+		{
+			if(a.rowLength() != a.columnLength())
+				throw std::invalid_argument("Matrix is not square");
+			return Matrix<T>(a.view());
+		}
+	}
+
+	// PA = LU with partial pivoting, computed right-looking in panels of factor_block columns.
+	// L (unit diagonal) and U share one matrix; the permutation is kept as row swaps.
+	template <class T>
+	class LU
+	{
+		static_assert(std::is_floating_point<T>::value, "LU needs a floating-point element type");
+
+	private:
+		Matrix<T> lu;
+		std::vector<size_t> piv;
+		bool odd = false;
+		bool singular = false;
+
+		// Factors columns [k, k + kb) of rows [k, n), swapping whole rows as pivots are chosen.
+		void factorPanel(size_t k, size_t kb)
+		{
+			size_t n = lu.rowLength();
+			T *a = lu.view().data();
+			for(size_t j = k; j < k + kb; j++)
+			{
+				size_t p = j;
+				for(size_t i = j + 1; i < n; i++)
+					if(std::abs(a[i * n + j]) > std::abs(a[p * n + j]))
+						p = i;
+				piv[j] = p;
+				if(p != j)
+				{
+					std::swap_ranges(a + j * n, a + j * n + n, a + p * n);
+					odd = !odd;
+				}
+				T d = a[j * n + j];
+				if(d == T())
+				{
+					singular = true;
+					continue;
+				}
+				for(size_t i = j + 1; i < n; i++)
+				{
+					T l = a[i * n + j] /= d;
+					for(size_t c = j + 1; c < k + kb; c++)
+						a[i * n + c] -= l * a[j * n + c];
+				}
+			}
+		}
+
+	public:
+		template <class A>
+		explicit LU(const Matrix<T, A> &m): lu(detail::square_copy(m)), piv(m.rowLength())
+		{
+			size_t n = lu.rowLength();
+			T *a = lu.view().data();
+			for(size_t k = 0; k < n; k += detail::factor_block)
+			{
+				size_t kb = std::min(detail::factor_block, n - k), e = k + kb;
+				factorPanel(k, kb);
+				// U12 = L11^-1 A12, then A22 -= L21 U12
+				detail::solve_lower(kb, a + k * n + k, n, true, n - e, a + k * n + e, n);
+				detail::gemm_sub(n - e, n - e, kb, a + e * n + k, n, a + k * n + e, n, a + e * n + e, n);
+			}
+		}
+
+		bool isSingular() const { return singular; }
+
+		// the packed factors: L below the diagonal, U on and above it
+		const Matrix<T> &factors() const { return lu; }
+
+		// row i of PA was row pivots()[i] of A after rows 0 .. i-1 were swapped
+		const std::vector<size_t> &pivots() const { return piv; }
+
+		T determinant() const
+		{
+			T det = odd ? T(-1) : T(1);
+			for(size_t i = 0; i < lu.rowLength(); i++)
+				det *= lu(i, i);
+			return det;
+		}
+
+		// x with A x = b, for every column of b
+		template <class A>
+		Matrix<T> solve(const Matrix<T, A> &b) const
+		{
+			size_t n = lu.rowLength();
+			if(b.rowLength() != n)
+				throw std::invalid_argument("Size cannot match");
+			if(singular)
+				throw std::invalid_argument("Matrix is singular");
+			Matrix<T> x(b.view());
+			size_t m = x.columnLength();
+			T *px = x.view().data();
+			for(size_t i = 0; i < n; i++)
+				if(piv[i] != i)
+					std::swap_ranges(px + i * m, px + i * m + m, px + piv[i] * m);
+			const T *a = lu.view().data();
+			detail::solve_lower(n, a, n, true, m, px, m);
+			detail::solve_upper(n, a, n, m, px, m);
+			return x;
+		}
+
+		Matrix<T> inverse() const
+		{
+			size_t n = lu.rowLength();
+			Matrix<T> id(n, n);
+			for(size_t i = 0; i < n; i++)
+				id(i, i) = T(1);
+			return solve(id);
+		}
+	};
+
+	// A = L L^T for a symmetric positive definite A, using only its lower triangle.
+	// Each panel updates the trailing lower triangle one block row at a time through gemm.
+	template <class T>
+	class Cholesky
+	{
+		static_assert(std::is_floating_point<T>::value, "Cholesky needs a floating-point element type");
+
+	private:
+		Matrix<T> l;
+
+	public:
+		template <class A>
+		explicit Cholesky(const Matrix<T, A> &m): l(detail::square_copy(m))
+		{
+			size_t n = l.rowLength();
+			T *a = l.view().data();
+			const size_t nb = detail::factor_block;
+			std::vector<T> panel_t;
+			for(size_t k = 0; k < n; k += nb)
+			{
+				size_t kb = std::min(nb, n - k), e = k + kb;
+				// L11: unblocked, column by column
+				for(size_t j = k; j < e; j++)
+				{
+					T d = a[j * n + j];
+					for(size_t p = k; p < j; p++)
+						d -= a[j * n + p] * a[j * n + p];
+					if(!(d > T()))
+						throw std::invalid_argument("Matrix is not positive definite");
+					d = std::sqrt(d);
+					a[j * n + j] = d;
+					for(size_t i = j + 1; i < e; i++)
+					{
+						T s = a[i * n + j];
+						for(size_t p = k; p < j; p++)
+							s -= a[i * n + p] * a[j * n + p];
+						a[i * n + j] = s / d;
+					}
+				}
+				// L21 = A21 L11^-T
+				for(size_t i = e; i < n; i++)
+					for(size_t j = k; j < e; j++)
+					{
+						T s = a[i * n + j];
+						for(size_t p = k; p < j; p++)
+							s -= a[i * n + p] * a[j * n + p];
+						a[i * n + j] = s / a[j * n + j];
+					}
+				// A22 -= L21 L21^T, lower triangle only
+				panel_t.resize(kb * (n - e));
+				for(size_t i = e; i < n; i++)
+					for(size_t p = 0; p < kb; p++)
+						panel_t[p * (n - e) + i - e] = a[i * n + k + p];
+				for(size_t i = e; i < n; i += nb)
+				{
+					size_t rows = std::min(nb, n - i);
+					detail::gemm_sub(rows, i + rows - e, kb, a + i * n + k, n, panel_t.data(), n - e, a + i * n + e, n);
+				}
+			}
+			for(size_t i = 0; i < n; i++)
+				std::fill(a + i * n + i + 1, a + i * n + n, T());
+		}
+
+		const Matrix<T> &matrixL() const { return l; }
+
+		T determinant() const
+		{
+			T det = T(1);
+			for(size_t i = 0; i < l.rowLength(); i++)
+				det *= l(i, i) * l(i, i);
+			return det;
+		}
+
+		template <class A>
+		Matrix<T> solve(const Matrix<T, A> &b) const
+		{
+			size_t n = l.rowLength();
+			if(b.rowLength() != n)
+				throw std::invalid_argument("Size cannot match");
+			Matrix<T> x(b.view());
+			Matrix<T> lt = l.tran();
+			detail::solve_lower(n, l.view().data(), n, false, x.columnLength(), x.view().data(), x.columnLength());
+			detail::solve_upper(n, lt.view().data(), n, x.columnLength(), x.view().data(), x.columnLength());
+			return x;
+		}
+	};
+
+	// A = QR by Householder reflections, for an m x n A with m >= n. Panels are
+	// accumulated into the compact WY form I - V T V^T and applied to the trailing
+	// columns with two gemm calls.
+	template <class T>
+	class QR
+	{
+		static_assert(std::is_floating_point<T>::value, "QR needs a floating-point element type");
+
+	private:
+		Matrix<T> qr;
+		std::vector<T> tau;
+
+		// Q^T b in place for b with rows() rows, one reflector at a time
+		void applyQt(size_t cols, T *b) const
+		{
+			size_t m = qr.rowLength(), n = qr.columnLength();
+			const T *a = qr.view().data();
+			std::vector<T> w(cols);
+			for(size_t j = 0; j < n; j++)
+			{
+				if(tau[j] == T())
+					continue;
+				for(size_t c = 0; c < cols; c++)
+					w[c] = b[j * cols + c];
+				for(size_t i = j + 1; i < m; i++)
+					for(size_t c = 0; c < cols; c++)
+						w[c] += a[i * n + j] * b[i * cols + c];
+				for(size_t c = 0; c < cols; c++)
+					b[j * cols + c] -= tau[j] * w[c];
+				for(size_t i = j + 1; i < m; i++)
+					for(size_t c = 0; c < cols; c++)
+						b[i * cols + c] -= tau[j] * a[i * n + j] * w[c];
+			}
+		}
+
+	public:
+		template <class A>
+		explicit QR(const Matrix<T, A> &mat): qr(mat.view()), tau(mat.columnLength())
+		{
+			size_t m = qr.rowLength(), n = qr.columnLength();
+			if(m < n)
+				throw std::invalid_argument("QR needs at least as many rows as columns");
+			T *a = qr.view().data();
+			const size_t nb = detail::factor_block;
+			std::vector<T> v, t, w;
+			for(size_t k = 0; k < n; k += nb)
+			{
+				size_t kb = std::min(nb, n - k), e = k + kb, rows = m - k;
+				for(size_t j = k; j < e; j++)
+				{
+					// reflector that zeroes a[j + 1 .., j]
+					T alpha = a[j * n + j], sigma = T();
+					for(size_t i = j + 1; i < m; i++)
+						sigma += a[i * n + j] * a[i * n + j];
+					if(sigma == T())
+					{
+						tau[j] = T();
+						continue;
+					}
+					T beta = std::sqrt(alpha * alpha + sigma);
+					if(alpha > T())
+						beta = -beta;
+					tau[j] = (beta - alpha) / beta;
+					for(size_t i = j + 1; i < m; i++)
+						a[i * n + j] /= alpha - beta;
+					a[j * n + j] = beta;
+					// apply it to the rest of the panel
+					for(size_t c = j + 1; c < e; c++)
+					{
+						T s = a[j * n + c];
+						for(size_t i = j + 1; i < m; i++)
+							s += a[i * n + j] * a[i * n + c];
+						s *= tau[j];
+						a[j * n + c] -= s;
+						for(size_t i = j + 1; i < m; i++)
+							a[i * n + c] -= s * a[i * n + j];
+					}
+				}
+				if(e == n)
+					break;
+				// V (rows x kb, unit lower trapezoidal) and the upper triangular T with H_k ... H_e-1 = I - V T V^T
+				v.assign(rows * kb, T());
+				for(size_t i = 0; i < rows; i++)
+					for(size_t p = 0; p < kb && p <= i; p++)
+						v[i * kb + p] = p == i ? T(1) : a[(k + i) * n + k + p];
+				t.assign(kb * kb, T());
+				for(size_t p = 0; p < kb; p++)
+				{
+					// t[0..p, p] = -tau_p T[0..p, 0..p] V[:, 0..p]^T v_p
+					for(size_t q = 0; q < p; q++)
+					{
+						T s = T();
+						for(size_t i = p; i < rows; i++)
+							s += v[i * kb + q] * v[i * kb + p];
+						t[q * kb + p] = -tau[k + p] * s;
+					}
+					for(size_t q = 0; q < p; q++)
+					{
+						T s = T();
+						for(size_t r = q; r < p; r++)
+							s += t[q * kb + r] * t[r * kb + p];
+						t[q * kb + p] = s;
+					}
+					t[p * kb + p] = tau[k + p];
+				}
+				// A22 -= V (T^T (V^T A22))
+				size_t cols = n - e;
+				std::vector<T> vt(kb * rows);
+				for(size_t i = 0; i < rows; i++)
+					for(size_t p = 0; p < kb; p++)
+						vt[p * rows + i] = v[i * kb + p];
+				w.assign(kb * cols, T());
+				detail::parallel_gemm(kb, cols, rows, vt.data(), rows, a + k * n + e, n, w.data(), cols);
+				std::vector<T> tw(kb * cols, T());
+				for(size_t p = 0; p < kb; p++)
+					for(size_t q = 0; q <= p; q++)
+					{
+						T x = t[q * kb + p];
+						for(size_t c = 0; c < cols; c++)
+							tw[p * cols + c] += x * w[q * cols + c];
+					}
+				detail::gemm_sub(rows, cols, kb, v.data(), kb, tw.data(), cols, a + k * n + e, n);
+			}
+		}
+
+		// R, the upper n x n triangle
+		Matrix<T> matrixR() const
+		{
+			size_t n = qr.columnLength();
+			Matrix<T> r(n, n);
+			for(size_t i = 0; i < n; i++)
+				for(size_t j = i; j < n; j++)
+					r(i, j) = qr(i, j);
+			return r;
+		}
+
+		// the first n columns of Q (m x n)
+		Matrix<T> matrixQ() const
+		{
+			size_t m = qr.rowLength(), n = qr.columnLength();
+			Matrix<T> qt(m, m), q(m, n);
+			for(size_t i = 0; i < m; i++)
+				qt(i, i) = T(1);
+			applyQt(m, qt.view().data());
+			for(size_t i = 0; i < m; i++)
+				for(size_t j = 0; j < n; j++)
+					q(i, j) = qt(j, i);
+			return q;
+		}
+
+		// least-squares x minimizing |A x - b| for every column of b
+		template <class A>
+		Matrix<T> solve(const Matrix<T, A> &b) const
+		{
+			size_t m = qr.rowLength(), n = qr.columnLength();
+			if(b.rowLength() != m)
+				throw std::invalid_argument("Size cannot match");
+			for(size_t i = 0; i < n; i++)
+				if(qr(i, i) == T())
+					throw std::invalid_argument("Matrix is rank deficient");
+			Matrix<T> y(b.view());
+			size_t cols = y.columnLength();
+			applyQt(cols, y.view().data());
+			// the first n rows; built explicitly since subView cannot express an empty range
+			Matrix<T> x(n, cols);
+			std::copy(y.view().data(), y.view().data() + n * cols, x.view().data());
+			detail::solve_upper(n, qr.view().data(), n, cols, x.view().data(), cols);
+			return x;
+		}
+	};
+
+	// x with a x = b, by LU
+	template <class T, class A, class B>
+	Matrix<T> solve(const Matrix<T, A> &a, const Matrix<T, B> &b)
+	{
+		return LU<T>(a).solve(b);
+	}
+
+	template <class T, class A>
+	Matrix<T> inverse(const Matrix<T, A> &a)
+	{
+		return LU<T>(a).inverse();
+	}
+
+	template <class T, class A>
+	T determinant(const Matrix<T, A> &a)
+	{
+		return LU<T>(a).determinant();
+	}
+}
+
+#endif //SJTU_LINALG_HPP
@@ -4,472 +4,2655 @@
 #ifndef SJTU_MATRIX_HPP
 #define SJTU_MATRIX_HPP
 #include <algorithm>
-
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "allocator.hpp"
+#include "thread_pool.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SJTU_MATRIX_X86
+#define SJTU_MATRIX_AVX2 __attribute__((target("avx2")))
+#define SJTU_MATRIX_FMA __attribute__((target("avx2,fma")))
+#if !defined(__clang__) && __GNUC__ >= 11
+#define SJTU_MATRIX_VNNI __attribute__((target("avx2,avxvnni")))
+#endif
+#define SJTU_MATRIX_INLINE inline __attribute__((always_inline))
+#else
+#define SJTU_MATRIX_INLINE inline
+#endif
+
+// operator() range-checks its indices (throwing std::invalid_argument) unless NDEBUG is
+// defined, in which case it is unchecked and noexcept; at() always checks.
+// Define SJTU_MATRIX_CHECKED to 0 or 1 to choose independently of NDEBUG.
+#ifndef SJTU_MATRIX_CHECKED
+#ifdef NDEBUG
+#define SJTU_MATRIX_CHECKED 0
+#else
+#define SJTU_MATRIX_CHECKED 1
+#endif
+#endif
+
+// kernels
 namespace sjtu
 {
-	template <class T>
-	class Matrix
+	namespace detail
 	{
+		const bool checked_access = SJTU_MATRIX_CHECKED != 0;
 
-	private:
-		size_t row_size;
-		size_t col_size;
-		T* data = nullptr;
-
-	public:
-		const T &operator()(size_t i, size_t j) const
+		inline void check_index(size_t i, size_t j, size_t n, size_t m)
 		{
-			if(!(i >= 0 && i < row_size && j >= 0 && j < col_size))
+			if(!(i < n && j < m))
 				throw std::invalid_argument("Out of range");
-			return data[col_size * i + j];
 		}
 
-		T &operator()(size_t i, size_t j)
+		enum ew_op { ew_add, ew_sub, ew_mul };
+
+		template <int OP> struct ew_scalar;
+		template <> struct ew_scalar<ew_add> { template <class T> static T apply(const T &a, const T &b) { return a + b; } };
+		template <> struct ew_scalar<ew_sub> { template <class T> static T apply(const T &a, const T &b) { return a - b; } };
+		template <> struct ew_scalar<ew_mul> { template <class T> static T apply(const T &a, const T &b) { return a * b; } };
+
+		// The right operand of an elementwise kernel is either another array or a scalar broadcast to every lane.
+		template <class T>
+		struct ew_broadcast
 		{
-			if(!(i >= 0 && i < row_size && j >= 0 && j < col_size))
-				throw std::invalid_argument("Out of range");
-			return data[col_size * i + j];
+			T value;
+			explicit ew_broadcast(const T &x): value(x) {}
+		};
+
+		template <class T> SJTU_MATRIX_INLINE const T &ew_elem(const T *b, size_t i) { return b[i]; }
+		template <class T> SJTU_MATRIX_INLINE const T &ew_elem(const ew_broadcast<T> &b, size_t) { return b.value; }
+		template <class T> SJTU_MATRIX_INLINE const T *ew_shift(const T *b, size_t i) { return b + i; }
+		template <class T> SJTU_MATRIX_INLINE const ew_broadcast<T> &ew_shift(const ew_broadcast<T> &b, size_t) { return b; }
+
+		struct isa_none {};
+
+		// One vector step of dst = a OP b for an instruction set; width 0 means no vector kernel.
+		template <class Isa, class T>
+		struct simd
+		{
+			static const size_t width = 0;
+			template <int OP, class B> static void apply(T *, const T *, const B &) {}
+		};
+
+#ifdef SJTU_MATRIX_X86
+		struct isa_sse2 {};
+		struct isa_avx2 {};
+
+#define SJTU_MATRIX_SIMD(ISA, TARGET, T, W, REG, MEM, LOAD, STORE, SET1, ADD, SUB, MUL) \
+		template <> \
+		struct simd<ISA, T> \
+		{ \
+			static const size_t width = W; \
+			template <int OP> TARGET static REG calc(REG x, REG y) \
+			{ \
+				return OP == ew_add ? ADD(x, y) : OP == ew_sub ? SUB(x, y) : MUL(x, y); \
+			} \
+			template <int OP> TARGET static void apply(T *d, const T *a, const T *b) \
+			{ \
+				STORE((MEM *)d, calc<OP>(LOAD((const MEM *)a), LOAD((const MEM *)b))); \
+			} \
+			template <int OP> TARGET static void apply(T *d, const T *a, const ew_broadcast<T> &b) \
+			{ \
+				STORE((MEM *)d, calc<OP>(LOAD((const MEM *)a), SET1(b.value))); \
+			} \
+		};
+
+		SJTU_MATRIX_SIMD(isa_sse2, , double, 2, __m128d, double, _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,
+						 _mm_add_pd, _mm_sub_pd, _mm_mul_pd)
+		SJTU_MATRIX_SIMD(isa_sse2, , float, 4, __m128, float, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+						 _mm_add_ps, _mm_sub_ps, _mm_mul_ps)
+		SJTU_MATRIX_SIMD(isa_avx2, SJTU_MATRIX_AVX2, double, 4, __m256d, double, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+						 _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd)
+		SJTU_MATRIX_SIMD(isa_avx2, SJTU_MATRIX_AVX2, float, 8, __m256, float, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+						 _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps)
+		SJTU_MATRIX_SIMD(isa_avx2, SJTU_MATRIX_AVX2, int, 8, __m256i, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_set1_epi32,
+						 _mm256_add_epi32, _mm256_sub_epi32, _mm256_mullo_epi32)
+#undef SJTU_MATRIX_SIMD
+#endif
+
+		// dst[i] = a[i] OP b[i] (or a[i] OP b for a scalar b); dst may alias a or b.
+		template <class Isa, int OP, class T, class B>
+		SJTU_MATRIX_INLINE void ew_body(T *dst, const T *a, const B &b, size_t n)
+		{
+			typedef simd<Isa, T> S;
+			size_t i = 0;
+			if(S::width != 0)
+				for(; i + S::width <= n; i += S::width)
+					S::template apply<OP>(dst + i, a + i, ew_shift(b, i));
+			for(; i < n; i++)
+				dst[i] = ew_scalar<OP>::apply(a[i], ew_elem(b, i));
 		}
-	public:
-		Matrix() = default;
 
-		Matrix(size_t n, size_t m, T _init = T()):row_size(n), col_size(m)
+#ifdef SJTU_MATRIX_X86
+		template <int OP, class T, class B>
+		SJTU_MATRIX_AVX2 void ew_avx2(T *dst, const T *a, const B &b, size_t n)
 		{
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] = _init;
+			ew_body<isa_avx2, OP>(dst, a, b, n);
 		}
 
-		explicit Matrix(std::pair<size_t, size_t> sz, T _init = T()):row_size(sz.first), col_size(sz.second)
+		template <int OP, class T, class B>
+		void ew_sse2(T *dst, const T *a, const B &b, size_t n)
 		{
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] = _init;
+			ew_body<isa_sse2, OP>(dst, a, b, n);
 		}
 
-		Matrix(const Matrix &o)
+		inline bool cpu_has_avx2()
 		{
-			row_size = o.row_size;
-			col_size = o.col_size;
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] = o.data[i];
+			static const bool ok = __builtin_cpu_supports("avx2");
+			return ok;
 		}
 
-		template <class U>
-		Matrix(const Matrix<U> &o)
+		inline bool cpu_has_fma()
 		{
-			row_size = o.rowLength();
-			col_size = o.columnLength();
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					data[col_size * i + j] = (T)o(i, j);
+			static const bool ok = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			return ok;
 		}
 
-		Matrix &operator=(const Matrix &o)
+		inline bool cpu_has_vnni()
 		{
-			if(this == &o)
-				return *this;
-            if(data != nullptr)
-                delete [] data;
-			row_size = o.rowLength();
-			col_size = o.columnLength();
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] = o.data[i];
-			return *this;
+#ifdef SJTU_MATRIX_VNNI
+			static const bool ok = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avxvnni");
+			return ok;
+#else
+			return false;
+#endif
 		}
+#endif
 
-		template <class U>
-		Matrix &operator=(const Matrix<U> &o)
+		template <int OP, class T, class B>
+		void elementwise(T *dst, const T *a, const B &b, size_t n)
 		{
-			if((void*)this == (void*)&o)
-				return *this;
-            if(data != nullptr)
-                delete [] data;
-			row_size = o.rowLength();
-			col_size = o.columnLength();
-			data = new T[row_size * col_size];
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					data[col_size * i + j] = (T)o(i, j);
-			return *this;
+#ifdef SJTU_MATRIX_X86
+			if(cpu_has_avx2())
+				ew_avx2<OP>(dst, a, b, n);
+			else
+				ew_sse2<OP>(dst, a, b, n);
+#else
+			ew_body<isa_none, OP>(dst, a, b, n);
+#endif
 		}
 
-		Matrix(Matrix &&o) noexcept: row_size(o.row_size), col_size(o.col_size), data(o.data)
-        {
-            o.data = nullptr;
-        }
-        //row_size = std::move(o.row_size)
+		// Blocking parameters of the packed GEMM: an MR x NR tile of C lives in
+		// registers, an MC x KC block of A stays in L2 and a KC x NR sliver of B in L1.
+		template <class T>
+		struct gemm_block
+		{
+			static constexpr size_t MR = 4;
+			static constexpr size_t NR = 32 / sizeof(T) < 4 ? 4 : 32 / sizeof(T);
+			static constexpr size_t MC = 128;
+			static constexpr size_t KC = 256;
+			static constexpr size_t NC = 4096;
+		};
 
-		Matrix &operator=(Matrix &&o) noexcept
+		// Copy rows [0, mc) x cols [0, kc) of A into MR-row panels, column by column,
+		// zero-padding the last panel. Element (i, k) of A is a[i * rs + k * cs], so
+		// row-major (rs = lda, cs = 1) and column-major (rs = 1, cs = lda) operands pack alike.
+		template <class R, class U>
+		void gemm_pack_a(const U *a, size_t rs, size_t cs, size_t mc, size_t kc, R *buf)
 		{
-			if(this == &o)
-				return *this;
-			if(data != nullptr)
-                delete [] data;
-			row_size = o.row_size;
-			col_size = o.col_size;
-			data = o.data;
-			o.data = nullptr;
-			return *this;
+			const size_t MR = gemm_block<R>::MR;
+			for(size_t i = 0; i < mc; i += MR)
+			{
+				size_t mr = std::min(MR, mc - i);
+				for(size_t k = 0; k < kc; k++)
+				{
+					for(size_t r = 0; r < mr; r++)
+						buf[r] = (R)a[(i + r) * rs + k * cs];
+					for(size_t r = mr; r < MR; r++)
+						buf[r] = R();
+					buf += MR;
+				}
+			}
 		}
 
-		~Matrix()
+		// Copy rows [0, kc) x cols [0, nc) of B into NR-column panels, row by row,
+		// zero-padding the last panel; element (k, j) of B is b[k * rs + j * cs].
+		template <class R, class V>
+		void gemm_pack_b(const V *b, size_t rs, size_t cs, size_t kc, size_t nc, R *buf)
 		{
-            if(data != nullptr)
-            {
-                delete [] data;
-                data = nullptr;
-            }
+			const size_t NR = gemm_block<R>::NR;
+			for(size_t j = 0; j < nc; j += NR)
+			{
+				size_t nr = std::min(NR, nc - j);
+				for(size_t k = 0; k < kc; k++)
+				{
+					const V *src = b + k * rs + j * cs;
+					if(cs == 1)
+						for(size_t c = 0; c < nr; c++)
+							buf[c] = (R)src[c];
+					else
+						for(size_t c = 0; c < nr; c++)
+							buf[c] = (R)src[c * cs];
+					for(size_t c = nr; c < NR; c++)
+						buf[c] = R();
+					buf += NR;
+				}
+			}
 		}
 
-		Matrix(std::initializer_list<std::initializer_list<T>> il)
+		// C[0..mr) x [0..nr) += packed A panel * packed B panel
+		template <class R>
+		void gemm_micro_kernel(size_t kc, const R *a, const R *b, R *c, size_t ldc, size_t mr, size_t nr, std::false_type)
 		{
-			bool flag = false;
-			row_size = il.size();
-			for(auto i:il)
+			const size_t MR = gemm_block<R>::MR, NR = gemm_block<R>::NR;
+			R acc[MR][NR] = {};
+			for(size_t k = 0; k < kc; k++)
 			{
-				if(!flag)
+				for(size_t i = 0; i < MR; i++)
 				{
-					col_size = i.size();
-					flag = true;
+					R ai = a[i];
+					for(size_t j = 0; j < NR; j++)
+						acc[i][j] += ai * b[j];
 				}
-				else if(col_size != i.size())
-					throw std::invalid_argument("invalid initializer_list");
+				a += MR;
+				b += NR;
 			}
-			data = new T[row_size * col_size];
-			size_t tmp = 0;
-			for(auto i:il)
-				for(auto j:i)
-					data[tmp++] = j;
+			for(size_t i = 0; i < mr; i++)
+				for(size_t j = 0; j < nr; j++)
+					c[i * ldc + j] += acc[i][j];
 		}
 
-	public:
-		size_t rowLength() const {return row_size;}
+		// true_type for accumulators with an AVX2 register tile below
+		template <class R>
+		using gemm_vector_tile = std::integral_constant<bool,
+#ifdef SJTU_MATRIX_X86
+			std::is_same<R, double>::value || std::is_same<R, float>::value || std::is_same<R, int>::value
+#else
+			false
+#endif
+			>;
+
+#ifdef SJTU_MATRIX_X86
+		SJTU_MATRIX_FMA inline __m256d gemm_load(const double *p) { return _mm256_loadu_pd(p); }
+		SJTU_MATRIX_FMA inline __m256 gemm_load(const float *p) { return _mm256_loadu_ps(p); }
+		SJTU_MATRIX_FMA inline __m256i gemm_load(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+		SJTU_MATRIX_FMA inline void gemm_store(double *p, __m256d x) { _mm256_storeu_pd(p, x); }
+		SJTU_MATRIX_FMA inline void gemm_store(float *p, __m256 x) { _mm256_storeu_ps(p, x); }
+		SJTU_MATRIX_FMA inline void gemm_store(int *p, __m256i x) { _mm256_storeu_si256((__m256i *)p, x); }
+		SJTU_MATRIX_FMA inline __m256d gemm_set1(double x) { return _mm256_set1_pd(x); }
+		SJTU_MATRIX_FMA inline __m256 gemm_set1(float x) { return _mm256_set1_ps(x); }
+		SJTU_MATRIX_FMA inline __m256i gemm_set1(int x) { return _mm256_set1_epi32(x); }
+		SJTU_MATRIX_FMA inline __m256d gemm_madd(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+		SJTU_MATRIX_FMA inline __m256 gemm_madd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+		SJTU_MATRIX_FMA inline __m256i gemm_madd(__m256i a, __m256i b, __m256i c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+
+		// The MR x NR tile as MR vectors of NR lanes, updated with fused multiply-adds.
+		template <class R>
+		SJTU_MATRIX_FMA void gemm_micro_kernel_fma(size_t kc, const R *a, const R *b, R *c, size_t ldc, size_t mr, size_t nr)
+		{
+			const size_t MR = gemm_block<R>::MR, NR = gemm_block<R>::NR;
+			static_assert(gemm_block<R>::MR == 4 && gemm_block<R>::NR * sizeof(R) == 32, "the tile is four AVX2 vectors");
+			typedef decltype(gemm_load(b)) reg;
+			reg c0 = gemm_set1(R()), c1 = c0, c2 = c0, c3 = c0;
+			for(size_t k = 0; k < kc; k++)
+			{
+				reg bk = gemm_load(b);
+				c0 = gemm_madd(gemm_set1(a[0]), bk, c0);
+				c1 = gemm_madd(gemm_set1(a[1]), bk, c1);
+				c2 = gemm_madd(gemm_set1(a[2]), bk, c2);
+				c3 = gemm_madd(gemm_set1(a[3]), bk, c3);
+				a += MR;
+				b += NR;
+			}
+			R acc[MR][NR];
+			gemm_store(acc[0], c0);
+			gemm_store(acc[1], c1);
+			gemm_store(acc[2], c2);
+			gemm_store(acc[3], c3);
+			for(size_t i = 0; i < mr; i++)
+				for(size_t j = 0; j < nr; j++)
+					c[i * ldc + j] += acc[i][j];
+		}
 
-		size_t columnLength() const {return col_size;}
+		template <class R>
+		void gemm_micro_kernel(size_t kc, const R *a, const R *b, R *c, size_t ldc, size_t mr, size_t nr, std::true_type)
+		{
+			if(cpu_has_fma())
+				gemm_micro_kernel_fma(kc, a, b, c, ldc, mr, nr);
+			else
+				gemm_micro_kernel(kc, a, b, c, ldc, mr, nr, std::false_type());
+		}
+#endif
 
-		void resize(size_t _n, size_t _m, T _init = T())
+		// Elements of the packed A and B panels gemm needs for an m x n x k product; they
+		// cover every smaller product too.
+		template <class R>
+		size_t gemm_pack_a_size(size_t m, size_t k)
+		{
+			const size_t MR = gemm_block<R>::MR, MC = gemm_block<R>::MC, KC = gemm_block<R>::KC;
+			return std::min(MC, (m + MR - 1) / MR * MR) * std::min(KC, k);
+		}
+
+		template <class R>
+		size_t gemm_pack_b_size(size_t n, size_t k)
+		{
+			const size_t NR = gemm_block<R>::NR, KC = gemm_block<R>::KC, NC = gemm_block<R>::NC;
+			return std::min(KC, k) * std::min(NC, (n + NR - 1) / NR * NR);
+		}
+
+		// gemm packing into caller-owned buffers of at least gemm_pack_a_size / gemm_pack_b_size elements
+		template <class R, class U, class V>
+		void gemm(size_t m, size_t n, size_t k, const U *a, size_t ars, size_t acs, const V *b, size_t brs, size_t bcs,
+				  R *c, size_t ldc, R *pa, R *pb)
 		{
-			if(_n * _m != row_size * col_size)
+			const size_t MR = gemm_block<R>::MR, NR = gemm_block<R>::NR;
+			const size_t MC = gemm_block<R>::MC, KC = gemm_block<R>::KC, NC = gemm_block<R>::NC;
+			if(m == 0 || n == 0 || k == 0)
+				return;
+			for(size_t jc = 0; jc < n; jc += NC)
 			{
-                T *tmp = new T[_n * _m];
-                for(size_t i = 0; i < std::min(_n * _m, row_size * col_size); i++)
-                    tmp[i] = data[i];
-                for(size_t i = row_size * col_size; i < _n * _m; i++)
-                    tmp[i] = _init;
-                delete [] data;
-                data = tmp;
+				size_t nc = std::min(NC, n - jc);
+				for(size_t pc = 0; pc < k; pc += KC)
+				{
+					size_t kc = std::min(KC, k - pc);
+					gemm_pack_b(b + pc * brs + jc * bcs, brs, bcs, kc, nc, pb);
+					for(size_t ic = 0; ic < m; ic += MC)
+					{
+						size_t mc = std::min(MC, m - ic);
+						gemm_pack_a(a + ic * ars + pc * acs, ars, acs, mc, kc, pa);
+						for(size_t jr = 0; jr < nc; jr += NR)
+							for(size_t ir = 0; ir < mc; ir += MR)
+								gemm_micro_kernel(kc, pa + ir * kc, pb + jr * kc,
+												  c + (ic + ir) * ldc + jc + jr, ldc,
+												  std::min(MR, mc - ir), std::min(NR, nc - jr), gemm_vector_tile<R>());
+					}
+				}
 			}
-			row_size = _n;
-			col_size = _m;
 		}
 
-		void resize(std::pair<size_t, size_t> sz, T _init = T())
+		template <class R, class U, class V>
+		void gemm(size_t m, size_t n, size_t k, const U *a, size_t ars, size_t acs, const V *b, size_t brs, size_t bcs,
+				  R *c, size_t ldc, std::false_type)
 		{
-			resize(sz.first, sz.second, _init);
+			if(m == 0 || n == 0 || k == 0)
+				return;
+			std::vector<R> pa(gemm_pack_a_size<R>(m, k)), pb(gemm_pack_b_size<R>(n, k));
+			gemm(m, n, k, a, ars, acs, b, brs, bcs, c, ldc, pa.data(), pb.data());
 		}
 
-		std::pair<size_t, size_t> size() const
+		template <class T>
+		using is_byte_integer = std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) == 1 && !std::is_same<T, bool>::value>;
+
+		// true_type for 8-bit integer operands accumulated in int, which have their own kernel below
+		template <class R, class U, class V>
+		using gemm_byte_operands = std::integral_constant<bool,
+#ifdef SJTU_MATRIX_X86
+			std::is_same<R, int>::value && is_byte_integer<U>::value && is_byte_integer<V>::value
+#else
+			false
+#endif
+			>;
+
+#ifdef SJTU_MATRIX_X86
+		// 8-bit GEMM: operands are widened to int16 while packing, with each pair of consecutive
+		// k interleaved so that one vpmaddwd (vpdpwssd with AVX-VNNI) performs two multiply-adds
+		// per lane. |a * b| <= 255 * 128, so the pair sums cannot overflow int32.
+		struct gemm_byte_block
 		{
-			return std::make_pair(row_size, col_size);
+			static constexpr size_t MR = 4;
+			static constexpr size_t NR = 16;
+			static constexpr size_t MC = 128;
+			static constexpr size_t KC = 512;
+			static constexpr size_t NC = 4096;
 		};
 
-		void clear()
+		// MR-row panels of k pairs: a[r][k], a[r][k + 1] for each row r, zero-padded.
+		template <class U>
+		void gemm_pack_a_pairs(const U *a, size_t rs, size_t cs, size_t mc, size_t kc, int16_t *buf)
 		{
-			row_size = col_size = 0;
-			this->~Matrix();
+			const size_t MR = gemm_byte_block::MR;
+			for(size_t i = 0; i < mc; i += MR)
+			{
+				size_t mr = std::min(MR, mc - i);
+				for(size_t k = 0; k < kc; k += 2)
+				{
+					for(size_t r = 0; r < MR; r++)
+					{
+						buf[2 * r] = r < mr ? (int16_t)a[(i + r) * rs + k * cs] : 0;
+						buf[2 * r + 1] = r < mr && k + 1 < kc ? (int16_t)a[(i + r) * rs + (k + 1) * cs] : 0;
+					}
+					buf += 2 * MR;
+				}
+			}
 		}
 
-	public:
+		// NR-column panels of k pairs: b[k][c], b[k + 1][c] for each column c, zero-padded.
+		template <class V>
+		void gemm_pack_b_pairs(const V *b, size_t rs, size_t cs, size_t kc, size_t nc, int16_t *buf)
+		{
+			const size_t NR = gemm_byte_block::NR;
+			for(size_t j = 0; j < nc; j += NR)
+			{
+				size_t nr = std::min(NR, nc - j);
+				for(size_t k = 0; k < kc; k += 2)
+				{
+					const V *src = b + k * rs + j * cs;
+					for(size_t c = 0; c < NR; c++)
+					{
+						buf[2 * c] = c < nr ? (int16_t)src[c * cs] : 0;
+						buf[2 * c + 1] = c < nr && k + 1 < kc ? (int16_t)src[rs + c * cs] : 0;
+					}
+					buf += 2 * NR;
+				}
+			}
+		}
 
-		Matrix<T> row(size_t i) const
+		SJTU_MATRIX_AVX2 inline __m256i gemm_dot_pairs(__m256i c, __m256i a, __m256i b, std::false_type)
 		{
-			if(!(i >= 0 && i < row_size))
-				throw std::invalid_argument("Out of range");
-			Matrix<T> tmp(1, col_size);
-			for(size_t j = 0; j < col_size; j++)
-                tmp(0, j) = (*this)(i, j);
-			return tmp;
+			return _mm256_add_epi32(c, _mm256_madd_epi16(a, b));
 		}
 
-		Matrix<T> column(size_t i) const
+#ifdef SJTU_MATRIX_VNNI
+		SJTU_MATRIX_VNNI inline __m256i gemm_dot_pairs(__m256i c, __m256i a, __m256i b, std::true_type)
 		{
-			if(!(i >= 0 && i < col_size))
-				throw std::invalid_argument("Out of range");
-			Matrix<T> tmp(row_size, 1);
-			for(size_t j = 0; j < row_size; j++)
-				tmp(j, 0) = (*this)(j, i);
-			return tmp;
+			return _mm256_dpwssd_avx_epi32(c, a, b);
 		}
+#endif
 
+		SJTU_MATRIX_AVX2 inline __m256i gemm_broadcast_pair(const int16_t *p)
+		{
+			int32_t x;
+			std::memcpy(&x, p, sizeof x);
+			return _mm256_set1_epi32(x);
+		}
 
-	public:
+		SJTU_MATRIX_AVX2 inline __m256i gemm_load_pairs(const int16_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+		SJTU_MATRIX_AVX2 inline __m256i gemm_zero_pairs() { return _mm256_setzero_si256(); }
+		SJTU_MATRIX_AVX2 inline void gemm_store_sums(int *p, __m256i x) { _mm256_storeu_si256((__m256i *)p, x); }
 
-        template <class U>
-        bool sameSize(const Matrix<U> &o) const
-        {
-            return row_size == o.rowLength() && col_size == o.columnLength();
-        }
+		// C[0..mr) x [0..nr) += kp packed k pairs of A and B, as four rows of two vectors.
+		template <class Vnni>
+		SJTU_MATRIX_AVX2 SJTU_MATRIX_INLINE void gemm_byte_kernel_body(size_t kp, const int16_t *a, const int16_t *b, int *c, size_t ldc, size_t mr, size_t nr)
+		{
+			const size_t MR = gemm_byte_block::MR, NR = gemm_byte_block::NR;
+			__m256i c00 = gemm_zero_pairs(), c01 = c00, c10 = c00, c11 = c00;
+			__m256i c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+			for(size_t p = 0; p < kp; p++)
+			{
+				__m256i b0 = gemm_load_pairs(b), b1 = gemm_load_pairs(b + 16);
+				__m256i a0 = gemm_broadcast_pair(a), a1 = gemm_broadcast_pair(a + 2);
+				c00 = gemm_dot_pairs(c00, a0, b0, Vnni());
+				c01 = gemm_dot_pairs(c01, a0, b1, Vnni());
+				c10 = gemm_dot_pairs(c10, a1, b0, Vnni());
+				c11 = gemm_dot_pairs(c11, a1, b1, Vnni());
+				__m256i a2 = gemm_broadcast_pair(a + 4), a3 = gemm_broadcast_pair(a + 6);
+				c20 = gemm_dot_pairs(c20, a2, b0, Vnni());
+				c21 = gemm_dot_pairs(c21, a2, b1, Vnni());
+				c30 = gemm_dot_pairs(c30, a3, b0, Vnni());
+				c31 = gemm_dot_pairs(c31, a3, b1, Vnni());
+				a += 2 * MR;
+				b += 2 * NR;
+			}
+			int acc[MR][NR];
+			gemm_store_sums(acc[0], c00);
+			gemm_store_sums(acc[0] + 8, c01);
+			gemm_store_sums(acc[1], c10);
+			gemm_store_sums(acc[1] + 8, c11);
+			gemm_store_sums(acc[2], c20);
+			gemm_store_sums(acc[2] + 8, c21);
+			gemm_store_sums(acc[3], c30);
+			gemm_store_sums(acc[3] + 8, c31);
+			for(size_t i = 0; i < mr; i++)
+				for(size_t j = 0; j < nr; j++)
+					c[i * ldc + j] += acc[i][j];
+		}
 
-		template <class U>
-		bool operator==(const Matrix<U> &o) const
+		SJTU_MATRIX_AVX2 inline void gemm_byte_kernel_avx2(size_t kp, const int16_t *a, const int16_t *b, int *c, size_t ldc, size_t mr, size_t nr)
 		{
-			if(!sameSize(o))
-                return false;
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					if((*this)(i, j) != o(i, j))
-						return false;
-			return true;
+			gemm_byte_kernel_body<std::false_type>(kp, a, b, c, ldc, mr, nr);
 		}
 
-		template <class U>
-		bool operator!=(const Matrix<U> &o) const
+#ifdef SJTU_MATRIX_VNNI
+		SJTU_MATRIX_VNNI inline void gemm_byte_kernel_vnni(size_t kp, const int16_t *a, const int16_t *b, int *c, size_t ldc, size_t mr, size_t nr)
 		{
-			return !(*this == o);
+			gemm_byte_kernel_body<std::true_type>(kp, a, b, c, ldc, mr, nr);
 		}
+#endif
 
-		Matrix operator-() const
+		template <class U, class V>
+		void gemm_bytes(size_t m, size_t n, size_t k, const U *a, size_t ars, size_t acs, const V *b, size_t brs, size_t bcs,
+						int *c, size_t ldc)
 		{
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] = -data[i];
-            return *this;
+			const size_t MR = gemm_byte_block::MR, NR = gemm_byte_block::NR;
+			const size_t MC = gemm_byte_block::MC, KC = gemm_byte_block::KC, NC = gemm_byte_block::NC;
+			if(m == 0 || n == 0 || k == 0)
+				return;
+			bool vnni = cpu_has_vnni();
+			size_t pairs = (std::min(KC, k) + 1) / 2;
+			std::vector<int16_t> pa(std::min(MC, (m + MR - 1) / MR * MR) * 2 * pairs);
+			std::vector<int16_t> pb(2 * pairs * std::min(NC, (n + NR - 1) / NR * NR));
+			for(size_t jc = 0; jc < n; jc += NC)
+			{
+				size_t nc = std::min(NC, n - jc);
+				for(size_t pc = 0; pc < k; pc += KC)
+				{
+					size_t kc = std::min(KC, k - pc), kp = (kc + 1) / 2;
+					gemm_pack_b_pairs(b + pc * brs + jc * bcs, brs, bcs, kc, nc, pb.data());
+					for(size_t ic = 0; ic < m; ic += MC)
+					{
+						size_t mc = std::min(MC, m - ic);
+						gemm_pack_a_pairs(a + ic * ars + pc * acs, ars, acs, mc, kc, pa.data());
+						for(size_t jr = 0; jr < nc; jr += NR)
+							for(size_t ir = 0; ir < mc; ir += MR)
+							{
+								const int16_t *pa_panel = pa.data() + ir * 2 * kp, *pb_panel = pb.data() + jr * 2 * kp;
+								int *tile = c + (ic + ir) * ldc + jc + jr;
+								size_t mr = std::min(MR, mc - ir), nr = std::min(NR, nc - jr);
+#ifdef SJTU_MATRIX_VNNI
+								if(vnni)
+								{
+									gemm_byte_kernel_vnni(kp, pa_panel, pb_panel, tile, ldc, mr, nr);
+									continue;
+								}
+#endif
+								gemm_byte_kernel_avx2(kp, pa_panel, pb_panel, tile, ldc, mr, nr);
+							}
+					}
+				}
+			}
 		}
 
-		template <class U>
-		Matrix &operator+=(const Matrix<U> &o)
+		template <class R, class U, class V>
+		void gemm(size_t m, size_t n, size_t k, const U *a, size_t ars, size_t acs, const V *b, size_t brs, size_t bcs,
+				  R *c, size_t ldc, std::true_type)
 		{
-            if(!sameSize(o))
-                throw std::invalid_argument("Size cannot match");
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					(*this)(i, j) += (T)(o(i, j));
-			return *this;
+			if(cpu_has_avx2())
+				gemm_bytes(m, n, k, a, ars, acs, b, brs, bcs, c, ldc);
+			else
+				gemm(m, n, k, a, ars, acs, b, brs, bcs, c, ldc, std::false_type());
 		}
+#endif
 
-		template <class U>
-		Matrix &operator-=(const Matrix<U> &o)
+		// C (m x n) += A (m x k) * B (k x n), all row-major with leading dimensions lda, ldb, ldc.
+		// The product is accumulated in R, whatever the operand types.
+		template <class R, class U, class V>
+		void gemm(size_t m, size_t n, size_t k, const U *a, size_t lda, const V *b, size_t ldb, R *c, size_t ldc)
 		{
-            if(!sameSize(o))
-                throw std::invalid_argument("Size cannot match");
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					(*this)(i, j) -= (T)(o(i, j));
-			return *this;
+			gemm(m, n, k, a, lda, size_t(1), b, ldb, size_t(1), c, ldc, gemm_byte_operands<R, U, V>());
 		}
 
-		template <class U>
-		Matrix &operator*=(const U &x)
+		// Minimum amount of work (multiply-adds or elements) before a kernel is split across threads.
+		const size_t parallel_gemm_work = size_t(1) << 21;
+		const size_t parallel_grain = size_t(1) << 15;
+
+		// gemm split into 2D tiles of C: MC-row panels, and column strips when there are
+		// too few panels to keep every thread busy. Tiles never share output, so no locking.
+		// A and B are addressed through row and column strides (see gemm_pack_a), C is row-major.
+		template <class R, class U, class V>
+		void parallel_gemm(size_t m, size_t n, size_t k, const U *a, size_t ars, size_t acs, const V *b, size_t brs, size_t bcs,
+						   R *c, size_t ldc)
 		{
-			for(size_t i = 0; i < row_size * col_size; i++)
-				data[i] *= (T)x;
-			return *this;
+			const size_t MR = gemm_block<R>::MR, NR = gemm_block<R>::NR, MC = gemm_block<R>::MC;
+			size_t threads = thread_count();
+			if(threads <= 1 || m * n * k < parallel_gemm_work)
+			{
+				gemm(m, n, k, a, ars, acs, b, brs, bcs, c, ldc, gemm_byte_operands<R, U, V>());
+				return;
+			}
+			size_t tile_m = MC;
+			size_t rows = (m + tile_m - 1) / tile_m;
+			if(rows < threads)
+			{
+				tile_m = std::max(MR, (m / threads + MR - 1) / MR * MR);
+				rows = (m + tile_m - 1) / tile_m;
+			}
+			size_t cols = std::max(size_t(1), std::min((threads * 4 + rows - 1) / rows, (n + NR - 1) / NR));
+			size_t tile_n = ((n + cols - 1) / cols + NR - 1) / NR * NR;
+			cols = (n + tile_n - 1) / tile_n;
+			pool().run(rows * cols, [&](size_t t) {
+				size_t i = t / cols * tile_m, j = t % cols * tile_n;
+				gemm(std::min(tile_m, m - i), std::min(tile_n, n - j), k, a + i * ars, ars, acs,
+					 b + j * bcs, brs, bcs, c + i * ldc + j, ldc, gemm_byte_operands<R, U, V>());
+			});
 		}
 
-		Matrix tran() const
+		template <class R, class U, class V>
+		void parallel_gemm(size_t m, size_t n, size_t k, const U *a, size_t lda, const V *b, size_t ldb, R *c, size_t ldc)
 		{
-			Matrix tmp(col_size, row_size);
-			size_t pos = 0;
-			for(size_t j = 0; j < col_size; j++)
-				for(size_t i = 0; i < row_size; i++)
-					tmp.data[pos++] = (*this)(i, j);
-			return tmp;
+			parallel_gemm(m, n, k, a, lda, size_t(1), b, ldb, size_t(1), c, ldc);
 		}
 
-	using pii = std::pair<size_t, size_t>;
+		template <int OP, class T, class B>
+		void parallel_elementwise(T *dst, const T *a, const B &b, size_t n)
+		{
+			parallel_for(n, parallel_grain, [&](size_t lo, size_t hi) {
+				elementwise<OP>(dst + lo, a + lo, ew_shift(b, lo), hi - lo);
+			});
+		}
 
-	public: // iterator
-		class iterator
+		// Strassen-Winograd tuning: products whose three dimensions are all at least
+		// strassen_threshold() use it automatically, and the recursion hands blocks with a
+		// dimension below strassen_crossover() to gemm.
+		inline size_t &strassen_threshold()
 		{
-			friend class Matrix <T>;
-		public:
-			using iterator_category = std::random_access_iterator_tag;
-			using value_type        = T;
-			using pointer           = T *;
-			using reference         = T &;
-			using size_type         = size_t;
-			using difference_type   = std::ptrdiff_t;
+			static size_t n = 2048;
+			return n;
+		}
 
-			//iterator() = default;
+		inline size_t &strassen_crossover()
+		{
+			static size_t n = 256;
+			return n;
+		}
 
-			iterator(const iterator &) = default;
+		inline bool strassen_recurses(size_t m, size_t n, size_t k)
+		{
+			size_t leaf = std::max(strassen_crossover(), size_t(2));
+			return m >= leaf && n >= leaf && k >= leaf;
+		}
 
-			iterator &operator=(const iterator &) = default;
+		// Elements of scratch needed by strassen() for these sizes, summed over all levels.
+		inline size_t strassen_scratch(size_t m, size_t n, size_t k)
+		{
+			if(!strassen_recurses(m, n, k))
+				return 0;
+			m /= 2, n /= 2, k /= 2;
+			return m * k + k * n + m * n + strassen_scratch(m, n, k);
+		}
 
+		// One contiguous buffer carved up stack-wise by the recursion, so no level allocates,
+		// followed by the gemm packing buffers shared by every serial leaf and edge product.
+		template <class T>
+		class strassen_arena
+		{
 		private:
-			difference_type pos;
-			Matrix <T> *p;
-			pii lc, rc;
+			std::vector<T, AlignedAllocator<T>> buf;
+			size_t top = 0, stack, pack_a;
 
 		public:
+			strassen_arena(size_t n, size_t pack_a, size_t pack_b): buf(n + pack_a + pack_b), stack(n), pack_a(pack_a) {}
 
-            iterator(difference_type pos = -1, Matrix <T> *pt = nullptr, pii lc = std::make_pair(T(), T()), pii rc = std::make_pair(T(), T())): pos(pos), p(pt), lc(lc), rc(rc) {}
-			
-			difference_type operator-(const iterator &o)
-			{
-				return pos - o.pos;
-			}
+			T *packA() { return buf.data() + stack; }
 
-			iterator &operator+=(difference_type offset)
-			{
-				if(pos + offset > (p->rowLength()) * (p->columnLength()))
-					throw std::invalid_argument("Out of Range");
-				pos += offset;
-				return *this;
-			}
+			T *packB() { return buf.data() + stack + pack_a; }
 
-			iterator operator+(difference_type offset) const
+			T *take(size_t n)
 			{
-				if(pos + offset > (p->rowLength()) * (p->columnLength()))
-					throw std::invalid_argument("Out of Range");
-				return iterator(pos + offset, p, lc, rc);
+				T *p = buf.data() + top;
+				top += n;
+				return p;
 			}
 
-			iterator &operator-=(difference_type offset)
-			{
-				if(pos - offset < 0)
-					throw std::invalid_argument("Out of Range");
-				pos -= offset;
-				return *this;
-			}
+			size_t mark() const { return top; }
 
-			iterator operator-(difference_type offset) const
+			void restore(size_t m) { top = m; }
+		};
+
+		// dst = x OP y over a rows x cols block, row by row; dst may alias x or y.
+		template <int OP, class T>
+		void strassen_ew(size_t rows, size_t cols, const T *x, size_t ldx, const T *y, size_t ldy, T *dst, size_t ldd)
+		{
+			for(size_t i = 0; i < rows; i++)
+				elementwise<OP>(dst + i * ldd, x + i * ldx, y + i * ldy, cols);
+		}
+
+		// c = a * b for a leaf or a peeled edge. Serial products pack into the arena; parallel
+		// ones go through parallel_gemm, whose tiles pack into buffers of their own.
+		template <class T>
+		void strassen_gemm(size_t m, size_t n, size_t k, const T *a, size_t lda, const T *b, size_t ldb,
+						   T *c, size_t ldc, strassen_arena<T> &arena)
+		{
+			if(thread_count() > 1 && m * n * k >= parallel_gemm_work)
+				parallel_gemm(m, n, k, a, lda, b, ldb, c, ldc);
+			else
+				gemm(m, n, k, a, lda, size_t(1), b, ldb, size_t(1), c, ldc, arena.packA(), arena.packB());
+		}
+
+		// C (m x n) = A (m x k) * B (k x n) by the Winograd form of Strassen's algorithm:
+		// 7 half-size products and 15 additions per level, with the quadrants of C and
+		// three arena temporaries holding every intermediate. Odd trailing rows and
+		// columns are peeled off and finished with gemm.
+		template <class T>
+		void strassen(size_t m, size_t n, size_t k, const T *a, size_t lda, const T *b, size_t ldb,
+					  T *c, size_t ldc, strassen_arena<T> &arena)
+		{
+			if(!strassen_recurses(m, n, k))
 			{
-				if(pos - offset < 0)
-					throw std::invalid_argument("Out of Range");
-				return iterator(pos - offset, p, lc, rc);
+				for(size_t i = 0; i < m; i++)
+					std::fill(c + i * ldc, c + i * ldc + n, T());
+				strassen_gemm(m, n, k, a, lda, b, ldb, c, ldc, arena);
+				return;
 			}
-
-			iterator &operator++()
+			size_t mh = m / 2, nh = n / 2, kh = k / 2;
+			const T *a11 = a, *a12 = a + kh, *a21 = a + mh * lda, *a22 = a21 + kh;
+			const T *b11 = b, *b12 = b + nh, *b21 = b + kh * ldb, *b22 = b21 + nh;
+			T *c11 = c, *c12 = c + nh, *c21 = c + mh * ldc, *c22 = c21 + nh;
+
+			size_t saved = arena.mark();
+			T *x = arena.take(mh * kh), *y = arena.take(kh * nh), *z = arena.take(mh * nh);
+
+			strassen_ew<ew_sub>(mh, kh, a11, lda, a21, lda, x, kh);    // S3 = A11 - A21
+			strassen_ew<ew_sub>(kh, nh, b22, ldb, b12, ldb, y, nh);    // T3 = B22 - B12
+			strassen(mh, nh, kh, x, kh, y, nh, c21, ldc, arena);       // C21 = P7 = S3 T3
+			strassen_ew<ew_add>(mh, kh, a21, lda, a22, lda, x, kh);    // S1 = A21 + A22
+			strassen_ew<ew_sub>(kh, nh, b12, ldb, b11, ldb, y, nh);    // T1 = B12 - B11
+			strassen(mh, nh, kh, x, kh, y, nh, c22, ldc, arena);       // C22 = P5 = S1 T1
+			strassen_ew<ew_sub>(mh, kh, x, kh, a11, lda, x, kh);       // S2 = S1 - A11
+			strassen_ew<ew_sub>(kh, nh, b22, ldb, y, nh, y, nh);       // T2 = B22 - T1
+			strassen(mh, nh, kh, x, kh, y, nh, c12, ldc, arena);       // C12 = P6 = S2 T2
+			strassen_ew<ew_sub>(mh, kh, a12, lda, x, kh, x, kh);       // S4 = A12 - S2
+			strassen(mh, nh, kh, x, kh, b22, ldb, c11, ldc, arena);    // C11 = P3 = S4 B22
+			strassen(mh, nh, kh, a11, lda, b11, ldb, z, nh, arena);    // Z = P1 = A11 B11
+			strassen_ew<ew_add>(mh, nh, c12, ldc, z, nh, c12, ldc);    // C12 = U2 = P1 + P6
+			strassen_ew<ew_add>(mh, nh, c21, ldc, c12, ldc, c21, ldc); // C21 = U3 = U2 + P7
+			strassen_ew<ew_add>(mh, nh, c12, ldc, c22, ldc, c12, ldc); // C12 = U4 = U2 + P5
+			strassen_ew<ew_add>(mh, nh, c12, ldc, c11, ldc, c12, ldc); // C12 = U5 = U4 + P3
+			strassen_ew<ew_add>(mh, nh, c22, ldc, c21, ldc, c22, ldc); // C22 = U7 = U3 + P5
+			strassen_ew<ew_sub>(kh, nh, y, nh, b21, ldb, y, nh);       // T4 = T2 - B21
+			strassen(mh, nh, kh, a22, lda, y, nh, c11, ldc, arena);    // C11 = P4 = A22 T4
+			strassen_ew<ew_sub>(mh, nh, c21, ldc, c11, ldc, c21, ldc); // C21 = U6 = U3 - P4
+			strassen(mh, nh, kh, a12, lda, b21, ldb, c11, ldc, arena); // C11 = P2 = A12 B21
+			strassen_ew<ew_add>(mh, nh, c11, ldc, z, nh, c11, ldc);    // C11 = U1 = P1 + P2
+			arena.restore(saved);
+
+			size_t me = mh * 2, ne = nh * 2, ke = kh * 2;
+			if(ke < k)
+				strassen_gemm(me, ne, k - ke, a + ke, lda, b + ke * ldb, ldb, c, ldc, arena);
+			if(ne < n)
 			{
-				return (*this) += 1;
+				for(size_t i = 0; i < me; i++)
+					std::fill(c + i * ldc + ne, c + i * ldc + n, T());
+				strassen_gemm(me, n - ne, k, a, lda, b + ne, ldb, c + ne, ldc, arena);
 			}
-
-			iterator operator++(int)
+			if(me < m)
 			{
-				if(pos + 1 > (p->rowLength()) * (p->columnLength()))
-					throw std::invalid_argument("Out of Range");
-				iterator tmp = *this;
-				pos++;
-				return tmp;
+				for(size_t i = me; i < m; i++)
+					std::fill(c + i * ldc, c + i * ldc + n, T());
+				strassen_gemm(m - me, n, k, a + me * lda, lda, b, ldb, c + me * ldc, ldc, arena);
 			}
+		}
 
-			iterator &operator--()
+		template <class T>
+		void strassen(size_t m, size_t n, size_t k, const T *a, size_t lda, const T *b, size_t ldb, T *c, size_t ldc)
+		{
+			strassen_arena<T> arena(strassen_scratch(m, n, k), gemm_pack_a_size<T>(m, k), gemm_pack_b_size<T>(n, k));
+			strassen(m, n, k, a, lda, b, ldb, c, ldc, arena);
+		}
+
+		// dst (cols x rows) = transpose of src (rows x cols), element by element
+		template <class T>
+		void transpose_scalar(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
+		{
+			for(size_t i = 0; i < rows; i++)
+				for(size_t j = 0; j < cols; j++)
+					dst[j * ldd + i] = src[i * lds + j];
+		}
+
+#ifdef SJTU_MATRIX_X86
+		// 4 x 4 blocks of 32-bit elements transposed inside SSE registers. T is any 4-byte
+		// arithmetic type: only the unaligned loads and stores see it as float, and the
+		// edges are copied as T, never through a float lvalue.
+		template <class T>
+		void transpose_tile_32(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
+		{
+			size_t i = 0;
+			for(; i + 4 <= rows; i += 4)
 			{
-				return (*this) -= 1;
+				size_t j = 0;
+				for(; j + 4 <= cols; j += 4)
+				{
+					__m128 r0 = _mm_loadu_ps((const float *)(src + i * lds + j)), r1 = _mm_loadu_ps((const float *)(src + (i + 1) * lds + j));
+					__m128 r2 = _mm_loadu_ps((const float *)(src + (i + 2) * lds + j)), r3 = _mm_loadu_ps((const float *)(src + (i + 3) * lds + j));
+					_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+					_mm_storeu_ps((float *)(dst + j * ldd + i), r0);
+					_mm_storeu_ps((float *)(dst + (j + 1) * ldd + i), r1);
+					_mm_storeu_ps((float *)(dst + (j + 2) * ldd + i), r2);
+					_mm_storeu_ps((float *)(dst + (j + 3) * ldd + i), r3);
+				}
+				transpose_scalar(4, cols - j, src + i * lds + j, lds, dst + j * ldd + i, ldd);
 			}
+			transpose_scalar(rows - i, cols, src + i * lds, lds, dst + i, ldd);
+		}
 
-			iterator operator--(int)
+		// 2 x 2 blocks of 64-bit elements with SSE2, T as in transpose_tile_32
+		template <class T>
+		void transpose_tile_64(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
+		{
+			size_t i = 0;
+			for(; i + 2 <= rows; i += 2)
 			{
-				if(pos - 1 < 0)
-					throw std::invalid_argument("Out of Range");
-				iterator tmp = *this;
-				pos--;
-				return tmp;
+				size_t j = 0;
+				for(; j + 2 <= cols; j += 2)
+				{
+					__m128d r0 = _mm_loadu_pd((const double *)(src + i * lds + j)), r1 = _mm_loadu_pd((const double *)(src + (i + 1) * lds + j));
+					_mm_storeu_pd((double *)(dst + j * ldd + i), _mm_unpacklo_pd(r0, r1));
+					_mm_storeu_pd((double *)(dst + (j + 1) * ldd + i), _mm_unpackhi_pd(r0, r1));
+				}
+				transpose_scalar(2, cols - j, src + i * lds + j, lds, dst + j * ldd + i, ldd);
 			}
+			transpose_scalar(rows - i, cols, src + i * lds, lds, dst + i, ldd);
+		}
 
-			reference operator*() const
+		// 4 x 4 blocks of 64-bit elements with AVX
+		template <class T>
+		SJTU_MATRIX_AVX2 void transpose_tile_64_avx2(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
+		{
+			size_t i = 0;
+			for(; i + 4 <= rows; i += 4)
 			{
-				size_type col = rc.second - lc.second + 1;
-				size_type r = pos / col, c = pos - r * col;
-				return (*p)(r + lc.first, c + lc.second);
+				size_t j = 0;
+				for(; j + 4 <= cols; j += 4)
+				{
+					__m256d r0 = _mm256_loadu_pd((const double *)(src + i * lds + j)), r1 = _mm256_loadu_pd((const double *)(src + (i + 1) * lds + j));
+					__m256d r2 = _mm256_loadu_pd((const double *)(src + (i + 2) * lds + j)), r3 = _mm256_loadu_pd((const double *)(src + (i + 3) * lds + j));
+					__m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+					__m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+					_mm256_storeu_pd((double *)(dst + j * ldd + i), _mm256_permute2f128_pd(t0, t2, 0x20));
+					_mm256_storeu_pd((double *)(dst + (j + 1) * ldd + i), _mm256_permute2f128_pd(t1, t3, 0x20));
+					_mm256_storeu_pd((double *)(dst + (j + 2) * ldd + i), _mm256_permute2f128_pd(t0, t2, 0x31));
+					_mm256_storeu_pd((double *)(dst + (j + 3) * ldd + i), _mm256_permute2f128_pd(t1, t3, 0x31));
+				}
+				transpose_scalar(4, cols - j, src + i * lds + j, lds, dst + j * ldd + i, ldd);
 			}
+			transpose_scalar(rows - i, cols, src + i * lds, lds, dst + i, ldd);
+		}
+#endif
 
-			pointer operator->() const
+		// Arithmetic elements are only moved, never computed on, so any 4- or 8-byte
+		// arithmetic type can reuse the float / double register kernels.
+		template <class T>
+		using transpose_width = std::integral_constant<size_t, std::is_arithmetic<T>::value ? sizeof(T) : 0>;
+
+		template <class T, size_t W>
+		void transpose_tile(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd, std::integral_constant<size_t, W>)
+		{
+			transpose_scalar(rows, cols, src, lds, dst, ldd);
+		}
+
+#ifdef SJTU_MATRIX_X86
+		template <class T>
+		void transpose_tile(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd, std::integral_constant<size_t, 4>)
+		{
+			transpose_tile_32(rows, cols, src, lds, dst, ldd);
+		}
+
+		template <class T>
+		void transpose_tile(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd, std::integral_constant<size_t, 8>)
+		{
+			if(cpu_has_avx2())
+				transpose_tile_64_avx2(rows, cols, src, lds, dst, ldd);
+			else
+				transpose_tile_64(rows, cols, src, lds, dst, ldd);
+		}
+#endif
+
+		// Cache-oblivious out-of-place transpose: halve the longer side until the block
+		// fits in a tile, so both the reads and the writes stay within a few cache lines.
+		template <class T>
+		void transpose(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
+		{
+			const size_t TILE = 32;
+			if(rows <= TILE && cols <= TILE)
 			{
-				size_type col = rc.second - lc.second + 1;
-				size_type r = pos / col, c = pos - r * col;
-				return &(*p)(r + lc.first, c + lc.second);
+				transpose_tile(rows, cols, src, lds, dst, ldd, transpose_width<T>());
+				return;
 			}
-
-			bool operator==(const iterator &o) const
+			if(rows >= cols)
 			{
-				return pos == o.pos && p == o.p && lc == o.lc && rc == o.rc;
+				size_t h = (rows / 2 + 3) / 4 * 4;
+				transpose(h, cols, src, lds, dst, ldd);
+				transpose(rows - h, cols, src + h * lds, lds, dst + h, ldd);
 			}
-
-			bool operator!=(const iterator &o) const
+			else
 			{
-				return pos != o.pos || p != o.p || lc != o.lc || rc != o.rc;
+				size_t h = (cols / 2 + 3) / 4 * 4;
+				transpose(rows, h, src, lds, dst, ldd);
+				transpose(rows, cols - h, src + h, lds, dst + h * ldd, ldd);
 			}
-		};
+		}
 
-		iterator begin()
+		template <class T>
+		void parallel_transpose(size_t rows, size_t cols, const T *src, size_t lds, T *dst, size_t ldd)
 		{
-			return iterator(0, this, std::make_pair(0, 0), std::make_pair(row_size - 1, col_size - 1));
+			parallel_for(cols, std::max(size_t(32), parallel_grain / std::max(size_t(1), rows)), [&](size_t lo, size_t hi) {
+				transpose(rows, hi - lo, src + lo, lds, dst + lo * ldd, ldd);
+			});
 		}
 
-		iterator end()
+		// In-place transpose of an n x n block, swapping 32 x 32 tiles across the diagonal.
+		template <class T>
+		void transpose_square_inplace(size_t n, T *a, size_t ld)
 		{
-			return iterator((row_size * col_size), this, std::make_pair(0, 0), std::make_pair(row_size - 1, col_size - 1));
+			const size_t TILE = 32;
+			using std::swap;
+			for(size_t bi = 0; bi < n; bi += TILE)
+			{
+				size_t ei = std::min(n, bi + TILE);
+				for(size_t i = bi; i < ei; i++)
+					for(size_t j = i + 1; j < ei; j++)
+						swap(a[i * ld + j], a[j * ld + i]);
+				for(size_t bj = ei; bj < n; bj += TILE)
+				{
+					size_t ej = std::min(n, bj + TILE);
+					for(size_t i = bi; i < ei; i++)
+						for(size_t j = bj; j < ej; j++)
+							swap(a[i * ld + j], a[j * ld + i]);
+				}
+			}
 		}
 
-		std::pair<iterator, iterator> subMatrix(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r)
+		// In-place transpose of a contiguous rows x cols array by following permutation
+		// cycles: the element at index k moves to k * rows mod (rows * cols - 1).
+		// Needs one bit of bookkeeping per element instead of a second copy.
+		template <class T>
+		void transpose_cycles_inplace(size_t rows, size_t cols, T *a)
 		{
-			if(l.first > r.first || l.second < r.second)
-				throw std::invalid_argument("invalid submatrix");
-            if(l.first < 0 || r.first >= row_size || l.second < 0 || r.second >= col_size)
-                throw std::invalid_argument("Out of range");
-			return std::make_pair(iterator(0, this, l, r), iterator((r.first - l.first + 1) * (r.second - l.second + 1), this, l, r));
-		};
+			size_t n = rows * cols;
+			if(n < 3)
+				return;
+			std::vector<bool> moved(n);
+			for(size_t start = 1; start < n - 1; start++)
+			{
+				if(moved[start])
+					continue;
+				T carry = std::move(a[start]);
+				size_t k = start;
+				do
+				{
+					size_t to = (size_t)((unsigned long long)k * rows % (n - 1));
+					T tmp = std::move(a[to]);
+					a[to] = std::move(carry);
+					carry = std::move(tmp);
+					moved[to] = true;
+					k = to;
+				} while(k != start);
+			}
+		}
+	}
+
+	// How Matrix * Matrix is computed. Auto picks Strassen-Winograd for floating-point
+	// products whose dimensions all reach the threshold and the blocked GEMM otherwise.
+	// Each level of Strassen saves one multiplication in eight at the cost of a somewhat
+	// larger rounding error. Non-arithmetic element types always use the plain triple loop.
+	enum class MultiplyAlgorithm { Auto, Blocked, Strassen };
+
+	// smallest dimension at which MultiplyAlgorithm::Auto switches to Strassen-Winograd
+	inline void setStrassenThreshold(size_t n)
+	{
+		detail::strassen_threshold() = n;
+	}
+
+	inline size_t getStrassenThreshold()
+	{
+		return detail::strassen_threshold();
+	}
+
+	// blocks with a dimension below this size are multiplied by the blocked GEMM
+	inline void setStrassenCrossover(size_t n)
+	{
+		detail::strassen_crossover() = n;
+	}
+
+	inline size_t getStrassenCrossover()
+	{
+		return detail::strassen_crossover();
+	}
+}
+
+namespace sjtu
+{
+	template <class T, class Alloc = AlignedAllocator<T>> class Matrix;
+	template <class T> class MatrixView;
+	template <class T> class ConstMatrixView;
+	template <class E> struct MatrixExpr;
+	template <class T> class MatrixTerminal;
+	template <class T, size_t R, size_t C> class FixedMatrix;
+	template <class T> class SparseMatrix;
+	template <class T> class MappedMatrix;
+	template <class T> class MatrixBatch;
+
+	// Storage orders of LayoutMatrix: RowMajor is Matrix's own, ColMajor keeps each column
+	// contiguous, and Tiled stores square row-major tiles in Z (Morton) order, so blocks
+	// that are close in either direction stay close in memory.
+	enum class Layout { RowMajor, ColMajor, Tiled };
+
+	template <class T, Layout L> class LayoutMatrix;
+
+	// how Matrix::mapFile maps the file: shared and read-only, or private pages copied on first write
+	enum class MapMode { ReadOnly, CopyOnWrite };
+
+	namespace detail
+	{
+		template <class A> struct is_matrix : std::false_type {};
+		template <class T, class A> struct is_matrix<Matrix<T, A>> : std::true_type {};
+		template <class A> struct is_matrix_view : std::false_type {};
+		template <class T> struct is_matrix_view<MatrixView<T>> : std::true_type {};
+		template <class T> struct is_matrix_view<ConstMatrixView<T>> : std::true_type {};
+		template <class A> struct is_matrix_expr : std::is_base_of<MatrixExpr<A>, A> {};
+		template <class A> struct is_fixed_matrix : std::false_type {};
+		template <class T, size_t R, size_t C> struct is_fixed_matrix<FixedMatrix<T, R, C>> : std::true_type {};
+		template <class A> struct is_sparse_matrix : std::false_type {};
+		template <class T> struct is_sparse_matrix<SparseMatrix<T>> : std::true_type {};
+		template <class A> struct is_layout_matrix : std::false_type {};
+		template <class T, Layout L> struct is_layout_matrix<LayoutMatrix<T, L>> : std::true_type {};
+		template <class A> struct is_matrix_batch : std::false_type {};
+		template <class T> struct is_matrix_batch<MatrixBatch<T>> : std::true_type {};
+		template <class A> struct is_mapped_matrix : std::false_type {};
+		template <class T> struct is_mapped_matrix<MappedMatrix<T>> : std::true_type {};
+
+		struct uninitialized_t {};
+		const uninitialized_t uninitialized{};
+
+		template <class R, class A>
+		using rebind_matrix = Matrix<R, typename std::allocator_traits<A>::template rebind_alloc<R>>;
+
+		// enabled for the right-hand side of matrix * scalar and friends
+		template <class S>
+		using enable_scalar = typename std::enable_if<!is_matrix_expr<S>::value && !is_matrix<S>::value &&
+													  !is_matrix_view<S>::value && !is_fixed_matrix<S>::value &&
+													  !is_sparse_matrix<S>::value && !is_layout_matrix<S>::value &&
+													  !is_matrix_batch<S>::value && !is_mapped_matrix<S>::value>::type;
+	}
+
+	// A pointer dressed as an iterator over elements stored back to back. Under C++20 it
+	// models std::contiguous_iterator, so algorithms may lower copies to memmove.
+	template <class T>
+	class ContiguousIterator
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+#if __cplusplus > 201703L
+		using iterator_concept  = std::contiguous_iterator_tag;
+#endif
+		using value_type        = typename std::remove_cv<T>::type;
+		using element_type      = T;
+		using pointer           = T *;
+		using reference         = T &;
+		using difference_type   = std::ptrdiff_t;
+
+	private:
+		T *ptr = nullptr;
+
+	public:
+		ContiguousIterator() = default;
+
+		explicit ContiguousIterator(T *p) noexcept: ptr(p) {}
+
+		template <class U, class = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+		ContiguousIterator(const ContiguousIterator<U> &o) noexcept: ptr(o.operator->()) {}
+
+		reference operator*() const noexcept { return *ptr; }
+
+		pointer operator->() const noexcept { return ptr; }
+
+		reference operator[](difference_type n) const noexcept { return ptr[n]; }
+
+		ContiguousIterator &operator++() noexcept { ++ptr; return *this; }
+
+		ContiguousIterator operator++(int) noexcept { return ContiguousIterator(ptr++); }
+
+		ContiguousIterator &operator--() noexcept { --ptr; return *this; }
+
+		ContiguousIterator operator--(int) noexcept { return ContiguousIterator(ptr--); }
+
+		ContiguousIterator &operator+=(difference_type n) noexcept { ptr += n; return *this; }
+
+		ContiguousIterator &operator-=(difference_type n) noexcept { ptr -= n; return *this; }
+
+		ContiguousIterator operator+(difference_type n) const noexcept { return ContiguousIterator(ptr + n); }
+
+		friend ContiguousIterator operator+(difference_type n, const ContiguousIterator &it) noexcept { return it + n; }
+
+		ContiguousIterator operator-(difference_type n) const noexcept { return ContiguousIterator(ptr - n); }
+
+		difference_type operator-(const ContiguousIterator &o) const noexcept { return ptr - o.ptr; }
+
+		bool operator==(const ContiguousIterator &o) const noexcept { return ptr == o.ptr; }
+
+		bool operator!=(const ContiguousIterator &o) const noexcept { return ptr != o.ptr; }
+
+		bool operator<(const ContiguousIterator &o) const noexcept { return ptr < o.ptr; }
+
+		bool operator>(const ContiguousIterator &o) const noexcept { return ptr > o.ptr; }
+
+		bool operator<=(const ContiguousIterator &o) const noexcept { return ptr <= o.ptr; }
+
+		bool operator>=(const ContiguousIterator &o) const noexcept { return ptr >= o.ptr; }
+	};
+
+	// [first, last) as a range, as returned by Matrix::elements()
+	template <class T>
+	class ElementRange
+	{
+	private:
+		T *first, *last;
+
+	public:
+		ElementRange(T *first, T *last) noexcept: first(first), last(last) {}
+
+		ContiguousIterator<T> begin() const noexcept { return ContiguousIterator<T>(first); }
+
+		ContiguousIterator<T> end() const noexcept { return ContiguousIterator<T>(last); }
+
+		size_t size() const noexcept { return last - first; }
+
+		T *data() const noexcept { return first; }
+	};
+
+	template <class T, class Alloc>
+	class Matrix
+	{
+		template <class, class> friend class Matrix;
+		template <class> friend class MatrixView;
+		template <class> friend class ConstMatrixView;
+
+	private:
+		using alloc_traits = std::allocator_traits<Alloc>;
+
+		// Trivial element types are left uninitialised where a kernel overwrites them anyway.
+		static const bool trivial = std::is_trivial<T>::value;
+
+		size_t row_size = 0;
+		size_t col_size = 0;
+		T* elem = nullptr;
+		// allocated length of elem; only the first row_size * col_size elements are constructed
+		size_t reserved = 0;
+		Alloc alloc;
+
+		T *allocate(size_t n)
+		{
+			return n == 0 ? nullptr : alloc_traits::allocate(alloc, n);
+		}
+
+		void destroy(T *p, size_t lo, size_t hi) noexcept
+		{
+			if(!std::is_trivially_destructible<T>::value)
+				for(size_t i = lo; i < hi; i++)
+					alloc_traits::destroy(alloc, p + i);
+		}
+
+		// destroys the first n elements of p and frees all cap of them
+		void release(T *p, size_t n, size_t cap) noexcept
+		{
+			if(p == nullptr)
+				return;
+			destroy(p, 0, n);
+			alloc_traits::deallocate(alloc, p, cap);
+		}
+
+		// Allocates n elements and constructs each one exactly once from f(i).
+		template <class F>
+		T *build(size_t n, const F &f)
+		{
+			T *p = allocate(n);
+			size_t i = 0;
+			try
+			{
+				for(; i < n; i++)
+					alloc_traits::construct(alloc, p + i, f(i));
+			}
+			catch(...)
+			{
+				while(i > 0)
+					alloc_traits::destroy(alloc, p + --i);
+				alloc_traits::deallocate(alloc, p, n);
+				throw;
+			}
+			return p;
+		}
+
+		T *buildFilled(size_t n, const T &x)
+		{
+			return build(n, [&](size_t) -> const T & { return x; });
+		}
+
+		// Copies o converted to T; trivial types are filled in parallel.
+		template <class U, class B>
+		T *buildFrom(const Matrix<U, B> &o)
+		{
+			size_t n = o.row_size * o.col_size;
+			if(!trivial)
+				return build(n, [&](size_t i) { return (T)o.elem[i]; });
+			T *p = allocate(n);
+			detail::parallel_for(n, detail::parallel_grain, [&](size_t lo, size_t hi) {
+				for(size_t i = lo; i < hi; i++)
+					p[i] = (T)o.elem[i];
+			});
+			return p;
+		}
+
+		// adopts p, which holds n * m constructed elements and nothing more
+		void replace(T *p, size_t n, size_t m)
+		{
+			release(elem, row_size * col_size, reserved);
+			elem = p;
+			row_size = n;
+			col_size = m;
+			reserved = n * m;
+		}
+
+	public:
+		const T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return elem[col_size * i + j];
+		}
+
+		T &operator()(size_t i, size_t j) noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return elem[col_size * i + j];
+		}
+
+		const T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem[col_size * i + j];
+		}
+
+		T &at(size_t i, size_t j)
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem[col_size * i + j];
+		}
+	public:
+		using value_type = T;
+		using allocator_type = Alloc;
+
+		Matrix() = default;
+
+		explicit Matrix(const Alloc &a): alloc(a) {}
+
+		Matrix(size_t n, size_t m, T _init = T(), const Alloc &a = Alloc()):row_size(n), col_size(m), alloc(a)
+		{
+			elem = buildFilled(row_size * col_size, _init);
+			reserved = row_size * col_size;
+		}
+
+		explicit Matrix(std::pair<size_t, size_t> sz, T _init = T(), const Alloc &a = Alloc()):row_size(sz.first), col_size(sz.second), alloc(a)
+		{
+			elem = buildFilled(row_size * col_size, _init);
+			reserved = row_size * col_size;
+		}
+
+		// Storage for kernels that overwrite every element: trivial types are not initialised.
+		Matrix(size_t n, size_t m, detail::uninitialized_t, const Alloc &a = Alloc()):row_size(n), col_size(m), alloc(a)
+		{
+			elem = trivial ? allocate(row_size * col_size) : buildFilled(row_size * col_size, T());
+			reserved = row_size * col_size;
+		}
+
+		Matrix(const Matrix &o): alloc(alloc_traits::select_on_container_copy_construction(o.alloc))
+		{
+			elem = buildFrom(o);
+			row_size = o.row_size;
+			col_size = o.col_size;
+			reserved = row_size * col_size;
+		}
+
+		template <class U, class B>
+		Matrix(const Matrix<U, B> &o)
+		{
+			elem = buildFrom(o);
+			row_size = o.rowLength();
+			col_size = o.columnLength();
+			reserved = row_size * col_size;
+		}
+
+		Matrix &operator=(const Matrix &o)
+		{
+			if(this == &o)
+				return *this;
+			return assignFrom(o);
+		}
+
+		template <class U, class B>
+		Matrix &operator=(const Matrix<U, B> &o)
+		{
+			return assignFrom(o);
+		}
+
+		Matrix(Matrix &&o) noexcept: row_size(o.row_size), col_size(o.col_size), elem(o.elem), reserved(o.reserved), alloc(std::move(o.alloc))
+        {
+            o.elem = nullptr;
+            o.row_size = o.col_size = o.reserved = 0;
+        }
+
+		// Steals o's buffer unless the allocators differ and stay put, in which case the
+		// elements are copied; with always-equal allocators that case cannot arise.
+		Matrix &operator=(Matrix &&o) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+											   alloc_traits::is_always_equal::value)
+		{
+			if(this == &o)
+				return *this;
+			if(!alloc_traits::propagate_on_container_move_assignment::value && !alloc_traits::is_always_equal::value &&
+			   !(alloc == o.alloc))
+				return assignFrom(o);
+			release(elem, row_size * col_size, reserved);
+			if(alloc_traits::propagate_on_container_move_assignment::value)
+				alloc = std::move(o.alloc);
+			row_size = o.row_size;
+			col_size = o.col_size;
+			reserved = o.reserved;
+			elem = o.elem;
+			o.elem = nullptr;
+			o.row_size = o.col_size = o.reserved = 0;
+			return *this;
+		}
+
+		~Matrix()
+		{
+			release(elem, row_size * col_size, reserved);
+			elem = nullptr;
+		}
+
+		Matrix(std::initializer_list<std::initializer_list<T>> il, const Alloc &a = Alloc()): alloc(a)
+		{
+			bool flag = false;
+			row_size = il.size();
+			for(auto i:il)
+			{
+				if(!flag)
+				{
+					col_size = i.size();
+					flag = true;
+				}
+				else if(col_size != i.size())
+					throw std::invalid_argument("invalid initializer_list");
+			}
+			const T *rows[64], **row_ptr = rows;
+			std::vector<const T *> many;
+			if(row_size > 64)
+			{
+				many.resize(row_size);
+				row_ptr = many.data();
+			}
+			size_t tmp = 0;
+			for(auto &i:il)
+				row_ptr[tmp++] = i.begin();
+			elem = build(row_size * col_size, [&](size_t k) -> const T & { return row_ptr[k / col_size][k % col_size]; });
+			reserved = row_size * col_size;
+		}
+
+		template <class U>
+		Matrix(const ConstMatrixView<U> &o, const Alloc &a = Alloc()): alloc(a)
+		{
+			size_t m = o.columnLength();
+			elem = build(o.rowLength() * m, [&](size_t k) { return (T)o.data()[k / m * o.stride() + k % m]; });
+			row_size = o.rowLength();
+			col_size = m;
+			reserved = row_size * col_size;
+		}
+
+		template <class U>
+		Matrix(const MatrixView<U> &o, const Alloc &a = Alloc()): Matrix(ConstMatrixView<U>(o), a) {}
+
+		// needs fixed_matrix.hpp
+		template <class U, size_t R, size_t C>
+		Matrix(const FixedMatrix<U, R, C> &o, const Alloc &a = Alloc()): Matrix(o.view(), a) {}
+
+		// needs layout_matrix.hpp
+		template <class U, Layout L>
+		Matrix(const LayoutMatrix<U, L> &o, const Alloc &a = Alloc()): Matrix(o.rowLength(), o.columnLength(), detail::uninitialized, a)
+		{
+			o.copyRows(elem, col_size);
+		}
+
+		// needs sparse_matrix.hpp; explicit because the dense copy may be far larger
+		template <class U>
+		explicit Matrix(const SparseMatrix<U> &o, const Alloc &a = Alloc()): Matrix(o.rowLength(), o.columnLength(), T(), a)
+		{
+			for(auto it = o.begin(); it != o.end(); ++it)
+				elem[it.row() * col_size + it.column()] = (T)*it;
+		}
+
+		template <class E>
+		Matrix(const MatrixExpr<E> &e, const Alloc &a = Alloc()): alloc(a)
+		{
+			const E &x = e.self();
+			elem = build(e.rowLength() * e.columnLength(), [&](size_t k) { return (T)x[k]; });
+			row_size = e.rowLength();
+			col_size = e.columnLength();
+			reserved = row_size * col_size;
+		}
+
+		// Evaluates e in one pass; the buffer is reused when the shape is unchanged, so e may refer to *this.
+		template <class E>
+		Matrix &operator=(const MatrixExpr<E> &e)
+		{
+			const E &x = e.self();
+			if(e.rowLength() * e.columnLength() != row_size * col_size)
+				replace(build(e.rowLength() * e.columnLength(), [&](size_t k) { return (T)x[k]; }),
+						e.rowLength(), e.columnLength());
+			else
+			{
+				row_size = e.rowLength();
+				col_size = e.columnLength();
+				for(size_t i = 0; i < row_size * col_size; i++)
+					elem[i] = (T)x[i];
+			}
+			return *this;
+		}
+
+		Alloc get_allocator() const { return alloc; }
+
+	private:
+		// Copy assignment keeps the current buffer when the element count is unchanged.
+		template <class U, class B>
+		Matrix &assignFrom(const Matrix<U, B> &o)
+		{
+			size_t n = o.row_size * o.col_size;
+			if(n != row_size * col_size)
+				replace(buildFrom(o), o.row_size, o.col_size);
+			else
+			{
+				detail::parallel_for(n, trivial ? detail::parallel_grain : n, [&](size_t lo, size_t hi) {
+					for(size_t i = lo; i < hi; i++)
+						elem[i] = (T)o.elem[i];
+				});
+				row_size = o.row_size;
+				col_size = o.col_size;
+			}
+			return *this;
+		}
+
+	public:
+		size_t rowLength() const {return row_size;}
+
+		size_t columnLength() const {return col_size;}
+
+		// Keeps the first min(old, new) elements in storage order. The buffer is only
+		// reallocated when it grows past capacity(); shrinking never frees it.
+		void resize(size_t _n, size_t _m, T _init = T())
+		{
+			size_t n = _n * _m, old = row_size * col_size;
+			if(n > reserved)
+			{
+				T *tmp = build(n, [&](size_t i) -> const T & { return i < old ? elem[i] : _init; });
+				replace(tmp, _n, _m);
+				return;
+			}
+			if(n < old)
+				destroy(elem, n, old);
+			size_t i = old;
+			try
+			{
+				for(; i < n; i++)
+					alloc_traits::construct(alloc, elem + i, _init);
+			}
+			catch(...)
+			{
+				destroy(elem, old, i);
+				throw;
+			}
+			row_size = _n;
+			col_size = _m;
+		}
+
+		void resize(std::pair<size_t, size_t> sz, T _init = T())
+		{
+			resize(sz.first, sz.second, _init);
+		}
+
+		std::pair<size_t, size_t> size() const
+		{
+			return std::make_pair(row_size, col_size);
+		};
+
+		// number of elements the buffer holds without reallocating
+		size_t capacity() const { return reserved; }
+
+		void shrinkToFit()
+		{
+			if(reserved != row_size * col_size)
+				replace(build(row_size * col_size, [&](size_t i) -> T && { return std::move(elem[i]); }), row_size, col_size);
+		}
+
+		void clear()
+		{
+			replace(nullptr, 0, 0);
+		}
+
+	public:
+
+		Matrix row(size_t i) const
+		{
+			if(!(i < row_size))
+				throw std::invalid_argument("Out of range");
+			Matrix tmp(1, col_size, T(), alloc);
+			for(size_t j = 0; j < col_size; j++)
+				tmp.elem[j] = elem[i * col_size + j];
+			return tmp;
+		}
+
+		Matrix column(size_t i) const
+		{
+			if(!(i < col_size))
+				throw std::invalid_argument("Out of range");
+			Matrix tmp(row_size, 1, T(), alloc);
+			for(size_t j = 0; j < row_size; j++)
+				tmp.elem[j] = elem[j * col_size + i];
+			return tmp;
+		}
+
+	public: // views, which share storage with *this instead of copying it
+
+		MatrixView<T> view()
+		{
+			return MatrixView<T>(elem, row_size, col_size, col_size);
+		}
+
+		ConstMatrixView<T> view() const
+		{
+			return ConstMatrixView<T>(elem, row_size, col_size, col_size);
+		}
+
+		MatrixView<T> rowView(size_t i) { return view().row(i); }
+
+		ConstMatrixView<T> rowView(size_t i) const { return view().row(i); }
+
+		MatrixView<T> columnView(size_t i) { return view().column(i); }
+
+		ConstMatrixView<T> columnView(size_t i) const { return view().column(i); }
+
+		// the block with corners l and r (both inclusive), like subMatrix
+		MatrixView<T> subView(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r) { return view().subView(l, r); }
+
+		ConstMatrixView<T> subView(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r) const { return view().subView(l, r); }
+
+	public: // persistence, see matrix_io.hpp
+
+		// Maps a file written by save() into memory without reading or copying it.
+		static MappedMatrix<T> mapFile(const std::string &path, MapMode mode = MapMode::ReadOnly);
+
+	public:
+
+        template <class U, class B>
+        bool sameSize(const Matrix<U, B> &o) const
+        {
+            return row_size == o.rowLength() && col_size == o.columnLength();
+        }
+
+		template <class U, class B>
+		bool operator==(const Matrix<U, B> &o) const
+		{
+			if(!sameSize(o))
+                return false;
+			for(size_t i = 0; i < row_size * col_size; i++)
+				if(elem[i] != o.elem[i])
+					return false;
+			return true;
+		}
+
+		template <class U, class B>
+		bool operator!=(const Matrix<U, B> &o) const
+		{
+			return !(*this == o);
+		}
+
+		Matrix operator-() const &
+		{
+			Matrix tmp(*this);
+			return -std::move(tmp);
+		}
+
+		Matrix operator-() &&
+		{
+			for(size_t i = 0; i < row_size * col_size; i++)
+				elem[i] = -elem[i];
+			return std::move(*this);
+		}
+
+		template <class U, class B>
+		Matrix &operator+=(const Matrix<U, B> &o)
+		{
+            if(!sameSize(o))
+                throw std::invalid_argument("Size cannot match");
+			assignElementwise<detail::ew_add>(*this, o, kernelTag<U>());
+			return *this;
+		}
+
+		template <class U, class B>
+		Matrix &operator-=(const Matrix<U, B> &o)
+		{
+            if(!sameSize(o))
+                throw std::invalid_argument("Size cannot match");
+			assignElementwise<detail::ew_sub>(*this, o, kernelTag<U>());
+			return *this;
+		}
+
+		template <class U>
+		Matrix &operator+=(const ConstMatrixView<U> &o)
+		{
+			view() += o;
+			return *this;
+		}
+
+		template <class U>
+		Matrix &operator+=(const MatrixView<U> &o) { return *this += ConstMatrixView<U>(o); }
+
+		template <class U>
+		Matrix &operator-=(const ConstMatrixView<U> &o)
+		{
+			view() -= o;
+			return *this;
+		}
+
+		template <class U>
+		Matrix &operator-=(const MatrixView<U> &o) { return *this -= ConstMatrixView<U>(o); }
+
+		template <class E>
+		Matrix &operator+=(const MatrixExpr<E> &e)
+		{
+			if(row_size != e.rowLength() || col_size != e.columnLength())
+				throw std::invalid_argument("Size cannot match");
+			const E &x = e.self();
+			for(size_t i = 0; i < row_size * col_size; i++)
+				elem[i] += (T)x[i];
+			return *this;
+		}
+
+		template <class E>
+		Matrix &operator-=(const MatrixExpr<E> &e)
+		{
+			if(row_size != e.rowLength() || col_size != e.columnLength())
+				throw std::invalid_argument("Size cannot match");
+			const E &x = e.self();
+			for(size_t i = 0; i < row_size * col_size; i++)
+				elem[i] -= (T)x[i];
+			return *this;
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		Matrix &operator*=(const U &x)
+		{
+			scale((T)x, std::is_arithmetic<T>());
+			return *this;
+		}
+
+		Matrix tran() const
+		{
+			Matrix tmp(col_size, row_size, detail::uninitialized, alloc);
+			detail::parallel_transpose(row_size, col_size, elem, col_size, tmp.elem, row_size);
+			return tmp;
+		}
+
+		// Transposes without a second buffer: tile swaps for square matrices,
+		// cycle following (one bit per element of scratch) otherwise.
+		Matrix &tranInPlace()
+		{
+			if(row_size == col_size)
+				detail::transpose_square_inplace(row_size, elem, col_size);
+			else
+				detail::transpose_cycles_inplace(row_size, col_size, elem);
+			std::swap(row_size, col_size);
+			return *this;
+		}
+
+	public:
+		// true_type when Matrix<T> and Matrix<U> can share the raw SIMD kernels
+		template <class U>
+		using kernelTag = std::integral_constant<bool, std::is_same<T, U>::value && std::is_arithmetic<T>::value>;
+
+		// (*this) = a OP b elementwise, the sizes are assumed to match and a or b may be *this
+		template <int OP, class U, class A, class V, class B>
+		void assignElementwise(const Matrix<U, A> &a, const Matrix<V, B> &b, std::true_type)
+		{
+			detail::parallel_elementwise<OP>(elem, a.elem, b.elem, row_size * col_size);
+		}
+
+		template <int OP, class U, class A, class V, class B>
+		void assignElementwise(const Matrix<U, A> &a, const Matrix<V, B> &b, std::false_type)
+		{
+			detail::parallel_for(row_size * col_size, detail::parallel_grain, [&](size_t lo, size_t hi) {
+				for(size_t i = lo; i < hi; i++)
+				{
+					T y = (T)b.elem[i];
+					if((const void *)&a != (const void *)this)
+						elem[i] = (T)a.elem[i];
+					elem[i] = detail::ew_scalar<OP>::apply(elem[i], y);
+				}
+			});
+		}
+
+		void scale(const T &x, std::true_type)
+		{
+			detail::parallel_elementwise<detail::ew_mul>(elem, elem, detail::ew_broadcast<T>(x), row_size * col_size);
+		}
+
+		void scale(const T &x, std::false_type)
+		{
+			for(size_t i = 0; i < row_size * col_size; i++)
+				elem[i] *= x;
+		}
+
+		// (*this) += a * b, the sizes are assumed to match
+		template <class U, class A, class V, class B>
+		void multiplyAdd(const Matrix<U, A> &a, const Matrix<V, B> &b, std::true_type)
+		{
+			detail::parallel_gemm(row_size, col_size, a.col_size, a.elem, a.col_size, b.elem, col_size, elem, col_size);
+		}
+
+		template <class U, class A, class V, class B>
+		void multiplyAdd(const Matrix<U, A> &a, const Matrix<V, B> &b, std::false_type)
+		{
+			size_t mid = a.col_size;
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t k = 0; k < mid; k++)
+				{
+					const U &x = a.elem[i * mid + k];
+					const V *src = b.elem + k * col_size;
+					T *dst = elem + i * col_size;
+					for(size_t j = 0; j < col_size; j++)
+						dst[j] += x * src[j];
+				}
+		}
+
+		// (*this) = a * b, the sizes are assumed to match
+		template <class U, class A, class V, class B>
+		void assignProduct(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm alg, std::true_type)
+		{
+			size_t k = a.col_size;
+			bool large = std::min(std::min(row_size, col_size), k) >= detail::strassen_threshold();
+			if(alg == MultiplyAlgorithm::Strassen || (alg == MultiplyAlgorithm::Auto && std::is_floating_point<T>::value && large))
+			{
+				Matrix<T> ca, cb;
+				const T *pa = elementsAs(a, ca), *pb = elementsAs(b, cb);
+				detail::strassen(row_size, col_size, k, pa, k, pb, col_size, elem, col_size);
+				return;
+			}
+			std::fill(elem, elem + row_size * col_size, T());
+			multiplyAdd(a, b, std::true_type());
+		}
+
+		template <class U, class A, class V, class B>
+		void assignProduct(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm, std::false_type)
+		{
+			std::fill(elem, elem + row_size * col_size, T());
+			multiplyAdd(a, b, std::false_type());
+		}
+
+		// (*this) = a * b computed entirely in T. The kernels already work in T when every
+		// type is arithmetic; otherwise the operands are converted to T up front, so that
+		// no product is formed in U * V before being accumulated.
+		template <class U, class A, class V, class B>
+		void assignProductAs(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm alg, std::true_type)
+		{
+			assignProduct(a, b, alg, std::true_type());
+		}
+
+		template <class U, class A, class V, class B>
+		void assignProductAs(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm, std::false_type)
+		{
+			Matrix<T> ca, cb;
+			const T *pa = elementsAs(a, ca), *pb = elementsAs(b, cb);
+			size_t mid = a.col_size;
+			std::fill(elem, elem + row_size * col_size, T());
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t k = 0; k < mid; k++)
+				{
+					const T &x = pa[i * mid + k];
+					const T *src = pb + k * col_size;
+					T *dst = elem + i * col_size;
+					for(size_t j = 0; j < col_size; j++)
+						dst[j] += x * src[j];
+				}
+		}
+
+		// the elements of m as T, converted into copy when m holds another type
+		template <class A>
+		static const T *elementsAs(const Matrix<T, A> &m, Matrix<T> &)
+		{
+			return m.elem;
+		}
+
+		template <class U, class A>
+		static const T *elementsAs(const Matrix<U, A> &m, Matrix<T> &copy)
+		{
+			copy = m;
+			return copy.elem;
+		}
+
+	public: // iterators
+
+		// Visits a rectangular block of the matrix row by row. Stepping moves a pointer and
+		// jumps by (stride - width) at the end of each row, so ++ and * never divide;
+		// only random jumps (+=, -=, []) recompute the row and column.
+		template <bool Const>
+		class basic_iterator
+		{
+			friend class Matrix;
+			template <bool> friend class basic_iterator;
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type        = T;
+			using pointer           = typename std::conditional<Const, const T *, T *>::type;
+			using reference         = typename std::conditional<Const, const T &, T &>::type;
+			using size_type         = size_t;
+			using difference_type   = std::ptrdiff_t;
+
+		private:
+			pointer base = nullptr;
+			pointer cur = nullptr;
+			pointer row_end = nullptr;
+			difference_type pos = 0, total = 0;
+			size_t width = 0, stride = 0;
+
+			basic_iterator(pointer base, size_t width, size_t stride, difference_type total, difference_type pos):
+				base(base), pos(pos), total(total), width(width), stride(stride)
+			{
+				seek();
+			}
+
+			// Places cur at pos; the end position is one past the last element of the last row.
+			void seek()
+			{
+				if(total == 0)
+				{
+					cur = row_end = base;
+					return;
+				}
+				size_t r = pos / width, c = pos % width;
+				if(pos == total)
+					r--, c = width;
+				row_end = base + r * stride + width;
+				cur = row_end - width + c;
+			}
+
+			void jump(difference_type offset)
+			{
+				if(pos + offset > total || pos + offset < 0)
+					throw std::invalid_argument("Out of Range");
+				pos += offset;
+				seek();
+			}
+
+		public:
+			basic_iterator() = default;
+
+			basic_iterator(const basic_iterator<false> &o):
+				base(o.base), cur(o.cur), row_end(o.row_end), pos(o.pos), total(o.total), width(o.width), stride(o.stride) {}
+
+			basic_iterator &operator=(const basic_iterator &) = default;
+
+			difference_type operator-(const basic_iterator &o) const
+			{
+				return pos - o.pos;
+			}
+
+			basic_iterator &operator+=(difference_type offset)
+			{
+				jump(offset);
+				return *this;
+			}
+
+			basic_iterator operator+(difference_type offset) const
+			{
+				basic_iterator tmp = *this;
+				return tmp += offset;
+			}
+
+			friend basic_iterator operator+(difference_type offset, const basic_iterator &it)
+			{
+				return it + offset;
+			}
+
+			basic_iterator &operator-=(difference_type offset)
+			{
+				jump(-offset);
+				return *this;
+			}
+
+			basic_iterator operator-(difference_type offset) const
+			{
+				basic_iterator tmp = *this;
+				return tmp -= offset;
+			}
+
+			basic_iterator &operator++()
+			{
+				if(detail::checked_access && pos >= total)
+					throw std::invalid_argument("Out of Range");
+				pos++;
+				if(++cur == row_end && pos != total)
+				{
+					cur += stride - width;
+					row_end += stride;
+				}
+				return *this;
+			}
+
+			basic_iterator operator++(int)
+			{
+				basic_iterator tmp = *this;
+				++*this;
+				return tmp;
+			}
+
+			basic_iterator &operator--()
+			{
+				if(detail::checked_access && pos <= 0)
+					throw std::invalid_argument("Out of Range");
+				if(cur == row_end - width)
+				{
+					cur -= stride - width;
+					row_end -= stride;
+				}
+				cur--;
+				pos--;
+				return *this;
+			}
+
+			basic_iterator operator--(int)
+			{
+				basic_iterator tmp = *this;
+				--*this;
+				return tmp;
+			}
+
+			reference operator*() const
+			{
+				return *cur;
+			}
+
+			pointer operator->() const
+			{
+				return cur;
+			}
+
+			reference operator[](difference_type n) const
+			{
+				return *(*this + n);
+			}
+
+			bool operator==(const basic_iterator &o) const { return pos == o.pos && base == o.base; }
+
+			bool operator!=(const basic_iterator &o) const { return !(*this == o); }
+
+			bool operator<(const basic_iterator &o) const { return pos < o.pos; }
+
+			bool operator>(const basic_iterator &o) const { return pos > o.pos; }
+
+			bool operator<=(const basic_iterator &o) const { return pos <= o.pos; }
+
+			bool operator>=(const basic_iterator &o) const { return pos >= o.pos; }
+		};
+
+		using iterator = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+		using contiguous_iterator = ContiguousIterator<T>;
+		using const_contiguous_iterator = ContiguousIterator<const T>;
+
+		iterator begin()
+		{
+			return iterator(elem, col_size, col_size, row_size * col_size, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(elem, col_size, col_size, row_size * col_size, row_size * col_size);
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(elem, col_size, col_size, row_size * col_size, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(elem, col_size, col_size, row_size * col_size, row_size * col_size);
+		}
+
+		const_iterator cbegin() const { return begin(); }
+
+		const_iterator cend() const { return end(); }
+
+		std::pair<iterator, iterator> subMatrix(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r)
+		{
+			if(l.first > r.first || l.second > r.second)
+				throw std::invalid_argument("invalid submatrix");
+            if(r.first >= row_size || r.second >= col_size)
+                throw std::invalid_argument("Out of range");
+			T *base = elem + l.first * col_size + l.second;
+			size_t width = r.second - l.second + 1, total = (r.first - l.first + 1) * width;
+			return std::make_pair(iterator(base, width, col_size, total, 0), iterator(base, width, col_size, total, total));
+		};
+
+		// the elements in storage (row-major) order, back to back
+		T *data() noexcept { return elem; }
+
+		const T *data() const noexcept { return elem; }
+
+		// every element as one contiguous range, for std::copy and friends to see a plain array
+		ElementRange<T> elements() noexcept { return ElementRange<T>(elem, elem + row_size * col_size); }
+
+		ElementRange<const T> elements() const noexcept { return ElementRange<const T>(elem, elem + row_size * col_size); }
     };
 }
 
+// views
+namespace sjtu
+{
+	// A read-only window onto matrix storage: a pointer to the top-left element, a shape,
+	// and the distance (in elements) between the starts of consecutive rows.
+	// Views never own memory and are invalidated by anything that reallocates the matrix.
+	template <class T>
+	class ConstMatrixView
+	{
+	private:
+		const T *ptr = nullptr;
+		size_t row_size = 0;
+		size_t col_size = 0;
+		size_t ld = 0;
+
+	public:
+		using value_type = T;
+
+		ConstMatrixView() = default;
+
+		ConstMatrixView(const T *ptr, size_t n, size_t m, size_t ld): ptr(ptr), row_size(n), col_size(m), ld(ld) {}
+
+		template <class A>
+		ConstMatrixView(const Matrix<T, A> &o): ConstMatrixView(o.view()) {}
+
+		ConstMatrixView(const MatrixView<T> &o): ConstMatrixView(o.data(), o.rowLength(), o.columnLength(), o.stride()) {}
+
+		const T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return ptr[ld * i + j];
+		}
+
+		const T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return ptr[ld * i + j];
+		}
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::make_pair(row_size, col_size); }
+
+		size_t stride() const { return ld; }
+
+		const T *data() const { return ptr; }
+
+		ConstMatrixView row(size_t i) const
+		{
+			if(i >= row_size)
+				throw std::invalid_argument("Out of range");
+			return ConstMatrixView(ptr + ld * i, 1, col_size, ld);
+		}
+
+		ConstMatrixView column(size_t j) const
+		{
+			if(j >= col_size)
+				throw std::invalid_argument("Out of range");
+			return ConstMatrixView(ptr + j, row_size, 1, ld);
+		}
+
+		ConstMatrixView subView(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r) const
+		{
+			if(l.first > r.first || l.second > r.second)
+				throw std::invalid_argument("invalid submatrix");
+			if(r.first >= row_size || r.second >= col_size)
+				throw std::invalid_argument("Out of range");
+			return ConstMatrixView(ptr + ld * l.first + l.second, r.first - l.first + 1, r.second - l.second + 1, ld);
+		}
+
+		Matrix<T> tran() const
+		{
+			Matrix<T> tmp(col_size, row_size, detail::uninitialized);
+			detail::parallel_transpose(row_size, col_size, ptr, ld, tmp.view().data(), row_size);
+			return tmp;
+		}
+
+		template <class U>
+		bool operator==(const ConstMatrixView<U> &o) const
+		{
+			if(row_size != o.rowLength() || col_size != o.columnLength())
+				return false;
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					if(ptr[ld * i + j] != o.data()[o.stride() * i + j])
+						return false;
+			return true;
+		}
+
+		template <class U>
+		bool operator!=(const ConstMatrixView<U> &o) const
+		{
+			return !(*this == o);
+		}
+	};
+
+	// The writable counterpart of ConstMatrixView. Copying a view copies the window,
+	// not the elements; use assign() to copy elements into it.
+	template <class T>
+	class MatrixView
+	{
+	private:
+		T *ptr = nullptr;
+		size_t row_size = 0;
+		size_t col_size = 0;
+		size_t ld = 0;
+
+		template <int OP, class U>
+		void combine(const ConstMatrixView<U> &o)
+		{
+			if(row_size != o.rowLength() || col_size != o.columnLength())
+				throw std::invalid_argument("Size cannot match");
+			for(size_t i = 0; i < row_size; i++)
+				combineRow<OP>(ptr + ld * i, o.data() + o.stride() * i,
+							   std::integral_constant<bool, std::is_same<T, U>::value && std::is_arithmetic<T>::value>());
+		}
+
+		template <int OP, class U>
+		void combineRow(T *dst, const U *src, std::true_type)
+		{
+			detail::elementwise<OP>(dst, dst, src, col_size);
+		}
+
+		template <int OP, class U>
+		void combineRow(T *dst, const U *src, std::false_type)
+		{
+			for(size_t j = 0; j < col_size; j++)
+				dst[j] = detail::ew_scalar<OP>::apply(dst[j], (T)src[j]);
+		}
+
+	public:
+		using value_type = T;
+
+		MatrixView() = default;
+
+		MatrixView(T *ptr, size_t n, size_t m, size_t ld): ptr(ptr), row_size(n), col_size(m), ld(ld) {}
+
+		template <class A>
+		MatrixView(Matrix<T, A> &o): MatrixView(o.view()) {}
+
+		T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return ptr[ld * i + j];
+		}
+
+		T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return ptr[ld * i + j];
+		}
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::make_pair(row_size, col_size); }
+
+		size_t stride() const { return ld; }
+
+		T *data() const { return ptr; }
+
+		MatrixView row(size_t i) const
+		{
+			if(i >= row_size)
+				throw std::invalid_argument("Out of range");
+			return MatrixView(ptr + ld * i, 1, col_size, ld);
+		}
+
+		MatrixView column(size_t j) const
+		{
+			if(j >= col_size)
+				throw std::invalid_argument("Out of range");
+			return MatrixView(ptr + j, row_size, 1, ld);
+		}
+
+		MatrixView subView(std::pair<size_t, size_t> l, std::pair<size_t, size_t> r) const
+		{
+			if(l.first > r.first || l.second > r.second)
+				throw std::invalid_argument("invalid submatrix");
+			if(r.first >= row_size || r.second >= col_size)
+				throw std::invalid_argument("Out of range");
+			return MatrixView(ptr + ld * l.first + l.second, r.first - l.first + 1, r.second - l.second + 1, ld);
+		}
+
+		Matrix<T> tran() const
+		{
+			return ConstMatrixView<T>(*this).tran();
+		}
+
+		template <class U>
+		const MatrixView &assign(const ConstMatrixView<U> &o) const
+		{
+			if(row_size != o.rowLength() || col_size != o.columnLength())
+				throw std::invalid_argument("Size cannot match");
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					ptr[ld * i + j] = (T)o.data()[o.stride() * i + j];
+			return *this;
+		}
+
+		template <class U>
+		const MatrixView &assign(const MatrixView<U> &o) const { return assign(ConstMatrixView<U>(o)); }
+
+		template <class U, class A>
+		const MatrixView &assign(const Matrix<U, A> &o) const { return assign(o.view()); }
+
+		template <class U>
+		MatrixView &operator+=(const ConstMatrixView<U> &o)
+		{
+			combine<detail::ew_add>(o);
+			return *this;
+		}
+
+		template <class U>
+		MatrixView &operator+=(const MatrixView<U> &o) { return *this += ConstMatrixView<U>(o); }
+
+		template <class U, class A>
+		MatrixView &operator+=(const Matrix<U, A> &o) { return *this += o.view(); }
+
+		template <class U>
+		MatrixView &operator-=(const ConstMatrixView<U> &o)
+		{
+			combine<detail::ew_sub>(o);
+			return *this;
+		}
+
+		template <class U>
+		MatrixView &operator-=(const MatrixView<U> &o) { return *this -= ConstMatrixView<U>(o); }
+
+		template <class U, class A>
+		MatrixView &operator-=(const Matrix<U, A> &o) { return *this -= o.view(); }
+
+		template <class U, class = detail::enable_scalar<U>>
+		MatrixView &operator*=(const U &x)
+		{
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					ptr[ld * i + j] *= (T)x;
+			return *this;
+		}
+	};
+
+	namespace detail
+	{
+		template <class T, class A> ConstMatrixView<T> as_view(const Matrix<T, A> &m) { return m.view(); }
+		template <class T> ConstMatrixView<T> as_view(const MatrixView<T> &m) { return m; }
+		template <class T> ConstMatrixView<T> as_view(const ConstMatrixView<T> &m) { return m; }
+
+		// enabled when at least one side is a view and the other one is a view or a Matrix
+		template <class A, class B>
+		using enable_view_pair = typename std::enable_if<
+			(is_matrix_view<A>::value || is_matrix_view<B>::value) &&
+			(is_matrix_view<A>::value || is_matrix<A>::value) &&
+			(is_matrix_view<B>::value || is_matrix<B>::value), int>::type;
+
+		template <class U, class V>
+		auto multiply_views(const ConstMatrixView<U> &a, const ConstMatrixView<V> &b, std::true_type)
+		{
+			Matrix<decltype(U() * V())> tmp(a.rowLength(), b.columnLength());
+			parallel_gemm(a.rowLength(), b.columnLength(), a.columnLength(), a.data(), a.stride(),
+						  b.data(), b.stride(), tmp.view().data(), b.columnLength());
+			return tmp;
+		}
+
+		template <class U, class V>
+		auto multiply_views(const ConstMatrixView<U> &a, const ConstMatrixView<V> &b, std::false_type)
+		{
+			Matrix<decltype(U() * V())> tmp(a.rowLength(), b.columnLength());
+			for(size_t k = 0; k < a.columnLength(); k++)
+				for(size_t i = 0; i < a.rowLength(); i++)
+					for(size_t j = 0; j < b.columnLength(); j++)
+						tmp(i, j) += a(i, k) * b(k, j);
+			return tmp;
+		}
+	}
+
+	template <class A, class B, detail::enable_view_pair<A, B> = 0>
+	auto operator*(const A &a, const B &b)
+	{
+		auto x = detail::as_view(a);
+		auto y = detail::as_view(b);
+		if(x.columnLength() != y.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		typedef typename decltype(x)::value_type U;
+		typedef typename decltype(y)::value_type V;
+		return detail::multiply_views(x, y, std::integral_constant<bool, std::is_arithmetic<U>::value && std::is_arithmetic<V>::value>());
+	}
+
+	template <class A, class B, detail::enable_view_pair<A, B> = 0>
+	auto operator+(const A &a, const B &b)
+	{
+		auto x = detail::as_view(a);
+		auto y = detail::as_view(b);
+		Matrix<decltype(typename decltype(x)::value_type() * typename decltype(y)::value_type())> tmp(x);
+		tmp += y;
+		return tmp;
+	}
+
+	template <class A, class B, detail::enable_view_pair<A, B> = 0>
+	auto operator-(const A &a, const B &b)
+	{
+		auto x = detail::as_view(a);
+		auto y = detail::as_view(b);
+		Matrix<decltype(typename decltype(x)::value_type() * typename decltype(y)::value_type())> tmp(x);
+		tmp -= y;
+		return tmp;
+	}
+}
+
 //
 namespace sjtu
 {
-	template <class T, class U>
-	auto operator*(const Matrix<T> &mat, const U &x)
+	template <class T, class A, class U, class = detail::enable_scalar<U>>
+	auto operator*(const Matrix<T, A> &mat, const U &x)
 	{
-		Matrix<decltype(T() * U())> tmp(mat);
+		detail::rebind_matrix<decltype(T() * U()), A> tmp(mat);
 		tmp *= x;
 		return tmp;
 	};
 
-	template <class T, class U>
-	auto operator*(const U &x, const Matrix<T> &mat)
+	template <class T, class A, class U, class = detail::enable_scalar<U>>
+	auto operator*(const U &x, const Matrix<T, A> &mat)
 	{
 		return mat * x;
 	};
 
-	template <class U, class V>
-	auto operator*(const Matrix<U> &a, const Matrix<V> &b)
+	template <class U, class A, class V, class B>
+	auto multiply(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm alg)
 	{
 		size_t row_size = a.rowLength(), col_size = b.columnLength();
 		size_t mid = a.columnLength();
 		if(mid != b.rowLength())
 			throw std::invalid_argument("Size cannot match");
 
-		Matrix<decltype(U() * V())> tmp(row_size, col_size);
-		for(size_t k = 0; k < mid; k++)
-			for(size_t i = 0; i < row_size; i++)
-				for(size_t j = 0; j < col_size; j++)
-					tmp(i, j) += a(i, k) * b(k, j);
+		typedef decltype(U() * V()) R;
+		detail::rebind_matrix<R, A> tmp(row_size, col_size, detail::uninitialized, a.get_allocator());
+		tmp.assignProduct(a, b, alg, std::integral_constant<bool, std::is_arithmetic<U>::value && std::is_arithmetic<V>::value>());
+		return tmp;
+	};
+
+	// a * b with every product and sum carried out in Acc, which is also the result's element
+	// type: multiplyAs<double>(float, float) avoids float round-off, multiplyAs<int>(int8_t,
+	// int8_t) reads the narrow operands directly through a widening kernel.
+	template <class Acc, class U, class A, class V, class B>
+	detail::rebind_matrix<Acc, A> multiplyAs(const Matrix<U, A> &a, const Matrix<V, B> &b, MultiplyAlgorithm alg = MultiplyAlgorithm::Auto)
+	{
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		detail::rebind_matrix<Acc, A> tmp(a.rowLength(), b.columnLength(), detail::uninitialized, a.get_allocator());
+		tmp.assignProductAs(a, b, alg, std::integral_constant<bool,
+			std::is_arithmetic<U>::value && std::is_arithmetic<V>::value && std::is_arithmetic<Acc>::value>());
 		return tmp;
 	};
 
-	template <class U, class V>
-	auto operator+(const Matrix<U> &a, const Matrix<V> &b)
+	template <class U, class A, class V, class B>
+	auto operator*(const Matrix<U, A> &a, const Matrix<V, B> &b)
+	{
+		return multiply(a, b, MultiplyAlgorithm::Auto);
+	};
+
+	template <class U, class A, class V, class B>
+	auto operator+(const Matrix<U, A> &a, const Matrix<V, B> &b)
 	{
         if(!a.sameSize(b))
             throw std::invalid_argument("Size cannot match");
-		Matrix<decltype(U() * V())> tmp(a);
-		tmp += b;
+		typedef decltype(U() * V()) R;
+		detail::rebind_matrix<R, A> tmp(a.rowLength(), a.columnLength(), detail::uninitialized, a.get_allocator());
+		tmp.template assignElementwise<detail::ew_add>(a, b, std::integral_constant<bool,
+			std::is_same<R, U>::value && std::is_same<R, V>::value && std::is_arithmetic<R>::value>());
 		return tmp;
 	};
 
-	template <class U, class V>
-	auto operator-(const Matrix<U> &a, const Matrix<V> &b)
+	template <class U, class A, class V, class B>
+	auto operator-(const Matrix<U, A> &a, const Matrix<V, B> &b)
 	{
         if(!a.sameSize(b))
             throw std::invalid_argument("Size cannot match");
-		Matrix<decltype(U() * V())> tmp(a);
-		tmp -= b;
+		typedef decltype(U() * V()) R;
+		detail::rebind_matrix<R, A> tmp(a.rowLength(), a.columnLength(), detail::uninitialized, a.get_allocator());
+		tmp.template assignElementwise<detail::ew_sub>(a, b, std::integral_constant<bool,
+			std::is_same<R, U>::value && std::is_same<R, V>::value && std::is_arithmetic<R>::value>());
 		return tmp;
 	};
 
+	// Overloads for temporaries: when the result has the temporary's element type and
+	// allocator its buffer is reused, so a + b - c + d allocates only for a + b.
+	namespace detail
+	{
+		// enabled when an operator returning R may hand back the Matrix<T, A> operand itself
+		template <class R, class T, class A>
+		using enable_reuse = typename std::enable_if<std::is_same<R, Matrix<T, A>>::value, int>::type;
+	}
+
+	template <class T, class A, class U, class = detail::enable_scalar<U>, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator*(Matrix<T, A> &&mat, const U &x)
+	{
+		mat *= x;
+		return std::move(mat);
+	};
+
+	template <class T, class A, class U, class = detail::enable_scalar<U>, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator*(const U &x, Matrix<T, A> &&mat)
+	{
+		mat *= x;
+		return std::move(mat);
+	};
+
+	template <class T, class A, class U, class B, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator+(Matrix<T, A> &&a, const Matrix<U, B> &b)
+	{
+		a += b;
+		return std::move(a);
+	};
+
+	template <class U, class B, class T, class A, detail::enable_reuse<detail::rebind_matrix<decltype(U() * T()), B>, T, A> = 0>
+	Matrix<T, A> operator+(const Matrix<U, B> &a, Matrix<T, A> &&b)
+	{
+		if(!a.sameSize(b))
+			throw std::invalid_argument("Size cannot match");
+		b.template assignElementwise<detail::ew_add>(a, b, typename Matrix<T, A>::template kernelTag<U>());
+		return std::move(b);
+	};
+
+	template <class T, class A, class U, class B, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator+(Matrix<T, A> &&a, Matrix<U, B> &&b)
+	{
+		a += b;
+		return std::move(a);
+	};
+
+	template <class T, class A, class U, class B, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator-(Matrix<T, A> &&a, const Matrix<U, B> &b)
+	{
+		a -= b;
+		return std::move(a);
+	};
+
+	template <class U, class B, class T, class A, detail::enable_reuse<detail::rebind_matrix<decltype(U() * T()), B>, T, A> = 0>
+	Matrix<T, A> operator-(const Matrix<U, B> &a, Matrix<T, A> &&b)
+	{
+		if(!a.sameSize(b))
+			throw std::invalid_argument("Size cannot match");
+		b.template assignElementwise<detail::ew_sub>(a, b, typename Matrix<T, A>::template kernelTag<U>());
+		return std::move(b);
+	};
+
+	template <class T, class A, class U, class B, detail::enable_reuse<detail::rebind_matrix<decltype(T() * U()), A>, T, A> = 0>
+	Matrix<T, A> operator-(Matrix<T, A> &&a, Matrix<U, B> &&b)
+	{
+		a -= b;
+		return std::move(a);
+	};
+
+}
+
+// expression templates
+// lazy(a) + b - c * 2 builds a tree of lightweight nodes instead of temporaries;
+// nothing is computed until the tree is assigned to (or used to construct) a Matrix,
+// which then fills every element in a single pass.
+namespace sjtu
+{
+	template <class E>
+	struct MatrixExpr
+	{
+		const E &self() const { return static_cast<const E &>(*this); }
+
+		size_t rowLength() const { return self().rowLength(); }
+
+		size_t columnLength() const { return self().columnLength(); }
+
+		std::pair<size_t, size_t> size() const
+		{
+			return std::make_pair(rowLength(), columnLength());
+		}
+
+		auto eval() const
+		{
+			return Matrix<typename E::value_type>(*this);
+		}
+	};
+
+	template <class T>
+	class MatrixTerminal : public MatrixExpr<MatrixTerminal<T>>
+	{
+	private:
+		const T *p;
+		size_t row_size, col_size;
+
+	public:
+		using value_type = T;
+
+		template <class A>
+		explicit MatrixTerminal(const Matrix<T, A> &m): p(m.view().data()), row_size(m.rowLength()), col_size(m.columnLength()) {}
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		const T &operator[](size_t k) const { return p[k]; }
+	};
+
+	template <int OP, class L, class R>
+	class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<OP, L, R>>
+	{
+	private:
+		L l;
+		R r;
+
+	public:
+		using value_type = decltype(typename L::value_type() * typename R::value_type());
+
+		MatrixBinaryExpr(const L &l, const R &r): l(l), r(r)
+		{
+			if(l.rowLength() != r.rowLength() || l.columnLength() != r.columnLength())
+				throw std::invalid_argument("Size cannot match");
+		}
+
+		size_t rowLength() const { return l.rowLength(); }
+
+		size_t columnLength() const { return l.columnLength(); }
+
+		value_type operator[](size_t k) const
+		{
+			return detail::ew_scalar<OP>::apply((value_type)l[k], (value_type)r[k]);
+		}
+	};
+
+	template <class L, class S>
+	class MatrixScaleExpr : public MatrixExpr<MatrixScaleExpr<L, S>>
+	{
+	private:
+		L l;
+		S x;
+
+	public:
+		using value_type = decltype(typename L::value_type() * S());
+
+		MatrixScaleExpr(const L &l, const S &x): l(l), x(x) {}
+
+		size_t rowLength() const { return l.rowLength(); }
+
+		size_t columnLength() const { return l.columnLength(); }
+
+		value_type operator[](size_t k) const { return l[k] * x; }
+	};
+
+	template <class L>
+	class MatrixNegateExpr : public MatrixExpr<MatrixNegateExpr<L>>
+	{
+	private:
+		L l;
+
+	public:
+		using value_type = typename L::value_type;
+
+		explicit MatrixNegateExpr(const L &l): l(l) {}
+
+		size_t rowLength() const { return l.rowLength(); }
+
+		size_t columnLength() const { return l.columnLength(); }
+
+		value_type operator[](size_t k) const { return -l[k]; }
+	};
+
+	template <class T, class A>
+	MatrixTerminal<T> lazy(const Matrix<T, A> &m)
+	{
+		return MatrixTerminal<T>(m);
+	}
+
+	namespace detail
+	{
+		// Operands of a lazy expression: other expressions are held by value, matrices by reference.
+		template <class E> const E &expr_operand(const MatrixExpr<E> &e) { return e.self(); }
+		template <class T, class A> MatrixTerminal<T> expr_operand(const Matrix<T, A> &m) { return MatrixTerminal<T>(m); }
+
+		template <class A>
+		using expr_operand_t = typename std::decay<decltype(expr_operand(std::declval<const A &>()))>::type;
+
+		// enabled when at least one side is an expression and neither side is a scalar
+		template <class A, class B>
+		using enable_expr_pair = typename std::enable_if<
+			(is_matrix_expr<A>::value || is_matrix_expr<B>::value) &&
+			(is_matrix_expr<A>::value || is_matrix<A>::value) &&
+			(is_matrix_expr<B>::value || is_matrix<B>::value)>::type;
+	}
+
+	template <class A, class B, class = detail::enable_expr_pair<A, B>>
+	auto operator+(const A &a, const B &b)
+	{
+		return MatrixBinaryExpr<detail::ew_add, detail::expr_operand_t<A>, detail::expr_operand_t<B>>(
+			detail::expr_operand(a), detail::expr_operand(b));
+	}
+
+	template <class A, class B, class = detail::enable_expr_pair<A, B>>
+	auto operator-(const A &a, const B &b)
+	{
+		return MatrixBinaryExpr<detail::ew_sub, detail::expr_operand_t<A>, detail::expr_operand_t<B>>(
+			detail::expr_operand(a), detail::expr_operand(b));
+	}
+
+	template <class E, class S, class = detail::enable_scalar<S>>
+	auto operator*(const MatrixExpr<E> &e, const S &x)
+	{
+		return MatrixScaleExpr<E, S>(e.self(), x);
+	}
+
+	template <class E, class S, class = detail::enable_scalar<S>>
+	auto operator*(const S &x, const MatrixExpr<E> &e)
+	{
+		return MatrixScaleExpr<E, S>(e.self(), x);
+	}
+
+	template <class E>
+	auto operator-(const MatrixExpr<E> &e)
+	{
+		return MatrixNegateExpr<E>(e.self());
+	}
 }
 
 #endif //SJTU_MATRIX_HPP
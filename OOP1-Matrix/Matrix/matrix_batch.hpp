@@ -0,0 +1,285 @@
+//  matrix_batch.hpp
+//  Many same-shaped small matrices stored together and operated on as one.
+
+#ifndef SJTU_MATRIX_BATCH_HPP
+#define SJTU_MATRIX_BATCH_HPP
+#include "matrix.hpp"
+#include <utility>
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// Lanes processed together by the batched kernels: a few of these per operand
+		// element stay in L1/L2 while every (i, k, j) of a small product visits them.
+		const size_t batch_block = 256;
+
+		// c[t] += a[t] * b[t] for t < n
+		template <class T>
+		void batch_madd(T *c, const T *a, const T *b, size_t n, std::false_type)
+		{
+			for(size_t t = 0; t < n; t++)
+				c[t] += a[t] * b[t];
+		}
+
+#ifdef SJTU_MATRIX_X86
+		template <class T>
+		SJTU_MATRIX_FMA void batch_madd_fma(T *c, const T *a, const T *b, size_t n)
+		{
+			const size_t W = 32 / sizeof(T);
+			size_t t = 0;
+			for(; t + W <= n; t += W)
+				gemm_store(c + t, gemm_madd(gemm_load(a + t), gemm_load(b + t), gemm_load(c + t)));
+			for(; t < n; t++)
+				c[t] += a[t] * b[t];
+		}
+
+		template <class T>
+		void batch_madd(T *c, const T *a, const T *b, size_t n, std::true_type)
+		{
+			if(cpu_has_fma())
+				batch_madd_fma(c, a, b, n);
+			else
+				batch_madd(c, a, b, n, std::false_type());
+		}
+#endif
+	}
+
+	// count matrices of rows x columns, interleaved: element (i, j) of every matrix sits
+	// in one contiguous lane of count values, so each kernel walks the shape once and
+	// runs its inner loop across the batch, where it vectorises regardless of how small
+	// the matrices are. Shapes are checked once per operation, not once per matrix.
+	template <class T>
+	class MatrixBatch
+	{
+		template <class> friend class MatrixBatch;
+
+	private:
+		size_t batch = 0, row_size = 0, col_size = 0;
+		std::vector<T, AlignedAllocator<T>> elem;
+
+		size_t index(size_t b, size_t i, size_t j) const { return (i * col_size + j) * batch + b; }
+
+		void check(size_t b, size_t i, size_t j) const
+		{
+			if(!(b < batch))
+				throw std::invalid_argument("Out of range");
+			detail::check_index(i, j, row_size, col_size);
+		}
+
+	public:
+		using value_type = T;
+
+		MatrixBatch() = default;
+
+		MatrixBatch(size_t cnt, size_t n, size_t m, T _init = T()):
+			batch(cnt), row_size(n), col_size(m), elem(cnt * n * m, _init) {}
+
+		// every matrix must have the shape of the first
+		template <class U, class A>
+		explicit MatrixBatch(const std::vector<Matrix<U, A>> &ms)
+		{
+			if(ms.empty())
+				return;
+			batch = ms.size();
+			row_size = ms[0].rowLength();
+			col_size = ms[0].columnLength();
+			elem.resize(batch * row_size * col_size);
+			for(size_t b = 0; b < batch; b++)
+				setMatrix(b, ms[b]);
+		}
+
+		size_t count() const { return batch; }
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::make_pair(row_size, col_size); }
+
+		const T &operator()(size_t b, size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				check(b, i, j);
+			return elem[index(b, i, j)];
+		}
+
+		T &operator()(size_t b, size_t i, size_t j) noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				check(b, i, j);
+			return elem[index(b, i, j)];
+		}
+
+		const T &at(size_t b, size_t i, size_t j) const
+		{
+			check(b, i, j);
+			return elem[index(b, i, j)];
+		}
+
+		T &at(size_t b, size_t i, size_t j)
+		{
+			check(b, i, j);
+			return elem[index(b, i, j)];
+		}
+
+		// the count() values of element (i, j), one per matrix
+		const T *lane(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem.data() + index(0, i, j);
+		}
+
+		T *lane(size_t i, size_t j)
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem.data() + index(0, i, j);
+		}
+
+		T *data() { return elem.data(); }
+
+		const T *data() const { return elem.data(); }
+
+		// a copy of matrix b
+		Matrix<T> matrix(size_t b) const
+		{
+			if(!(b < batch))
+				throw std::invalid_argument("Out of range");
+			Matrix<T> tmp(row_size, col_size);
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					tmp(i, j) = elem[index(b, i, j)];
+			return tmp;
+		}
+
+		template <class U, class A>
+		void setMatrix(size_t b, const Matrix<U, A> &m)
+		{
+			if(!(b < batch))
+				throw std::invalid_argument("Out of range");
+			if(m.rowLength() != row_size || m.columnLength() != col_size)
+				throw std::invalid_argument("Size cannot match");
+			for(size_t i = 0; i < row_size; i++)
+				for(size_t j = 0; j < col_size; j++)
+					elem[index(b, i, j)] = (T)m(i, j);
+		}
+
+		template <class U>
+		bool sameSize(const MatrixBatch<U> &o) const
+		{
+			return batch == o.batch && row_size == o.row_size && col_size == o.col_size;
+		}
+
+		template <class U>
+		bool operator==(const MatrixBatch<U> &o) const
+		{
+			if(!sameSize(o))
+				return false;
+			for(size_t k = 0; k < elem.size(); k++)
+				if(elem[k] != o.elem[k])
+					return false;
+			return true;
+		}
+
+		template <class U>
+		bool operator!=(const MatrixBatch<U> &o) const
+		{
+			return !(*this == o);
+		}
+
+		MatrixBatch &operator+=(const MatrixBatch &o)
+		{
+			if(!sameSize(o))
+				throw std::invalid_argument("Size cannot match");
+			detail::parallel_elementwise<detail::ew_add>(elem.data(), elem.data(), o.elem.data(), elem.size());
+			return *this;
+		}
+
+		MatrixBatch &operator-=(const MatrixBatch &o)
+		{
+			if(!sameSize(o))
+				throw std::invalid_argument("Size cannot match");
+			detail::parallel_elementwise<detail::ew_sub>(elem.data(), elem.data(), o.elem.data(), elem.size());
+			return *this;
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		MatrixBatch &operator*=(const U &x)
+		{
+			detail::parallel_elementwise<detail::ew_mul>(elem.data(), elem.data(), detail::ew_broadcast<T>((T)x), elem.size());
+			return *this;
+		}
+
+		// transposes every matrix; lanes are moved whole
+		MatrixBatch tran() const
+		{
+			MatrixBatch tmp(batch, col_size, row_size);
+			detail::parallel_for(row_size * col_size, std::max(size_t(1), detail::parallel_grain / std::max(batch, size_t(1))), [&](size_t lo, size_t hi) {
+				for(size_t k = lo; k < hi; k++)
+				{
+					size_t i = k / col_size, j = k % col_size;
+					std::copy(elem.begin() + k * batch, elem.begin() + (k + 1) * batch, tmp.elem.begin() + (j * row_size + i) * batch);
+				}
+			});
+			return tmp;
+		}
+
+		// c[b] = a[b] * b[b] for every b, split across threads by ranges of the batch
+		friend MatrixBatch multiply(const MatrixBatch &a, const MatrixBatch &b)
+		{
+			if(a.batch != b.batch || a.col_size != b.row_size)
+				throw std::invalid_argument("Size cannot match");
+			size_t n = a.row_size, mid = a.col_size, m = b.col_size, cnt = a.batch;
+			MatrixBatch c(cnt, n, m);
+			size_t work = std::max(n * mid * m, size_t(1));
+			detail::parallel_for(cnt, std::max(detail::batch_block, detail::parallel_grain / work), [&](size_t lo, size_t hi) {
+				for(size_t s = lo; s < hi; s += detail::batch_block)
+				{
+					size_t len = std::min(detail::batch_block, hi - s);
+					for(size_t i = 0; i < n; i++)
+						for(size_t k = 0; k < mid; k++)
+						{
+							const T *x = a.elem.data() + (i * mid + k) * cnt + s;
+							for(size_t j = 0; j < m; j++)
+								detail::batch_madd(c.elem.data() + (i * m + j) * cnt + s, x,
+												   b.elem.data() + (k * m + j) * cnt + s, len, detail::gemm_vector_tile<T>());
+						}
+				}
+			});
+			return c;
+		}
+
+		friend MatrixBatch operator*(const MatrixBatch &a, const MatrixBatch &b)
+		{
+			return multiply(a, b);
+		}
+
+		friend MatrixBatch operator+(MatrixBatch a, const MatrixBatch &b)
+		{
+			a += b;
+			return a;
+		}
+
+		friend MatrixBatch operator-(MatrixBatch a, const MatrixBatch &b)
+		{
+			a -= b;
+			return a;
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		friend MatrixBatch operator*(MatrixBatch a, const U &x)
+		{
+			a *= x;
+			return a;
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		friend MatrixBatch operator*(const U &x, MatrixBatch a)
+		{
+			a *= x;
+			return a;
+		}
+	};
+}
+
+#endif //SJTU_MATRIX_BATCH_HPP
@@ -0,0 +1,300 @@
+//  matrix_io.hpp
+//  Binary files for sjtu::Matrix: save, load and zero-copy memory mapping.
+
+#ifndef SJTU_MATRIX_IO_HPP
+#define SJTU_MATRIX_IO_HPP
+#include "matrix.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SJTU_MATRIX_MMAP
+#endif
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// A file is this 64-byte header, padding up to data_offset (a multiple of alignment),
+		// then rows * cols elements row by row, all in the writer's byte order.
+		struct matrix_file_header
+		{
+			char magic[8];
+			uint32_t byte_order;
+			uint32_t version;
+			char kind;
+			uint8_t elem_size;
+			uint16_t reserved;
+			uint32_t alignment;
+			uint64_t rows;
+			uint64_t cols;
+			uint64_t data_offset;
+			uint8_t pad[16];
+		};
+
+		static_assert(sizeof(matrix_file_header) == 64, "matrix_file_header must stay 64 bytes");
+
+		const char matrix_file_magic[8] = "SJTUMAT";
+		const uint32_t matrix_file_byte_order = 0x01020304;
+		const uint32_t matrix_file_version = 1;
+		const uint32_t matrix_file_alignment = 64;
+
+		// 'b' bool, 'f' floating point, 'i' signed and 'u' unsigned integers
+		template <class T>
+		char matrix_file_kind()
+		{
+			static_assert(std::is_arithmetic<T>::value, "only arithmetic element types can be saved");
+			return std::is_same<T, bool>::value ? 'b' : std::is_floating_point<T>::value ? 'f' :
+				   std::is_signed<T>::value ? 'i' : 'u';
+		}
+
+		template <class T>
+		matrix_file_header make_matrix_file_header(size_t rows, size_t cols)
+		{
+			matrix_file_header h;
+			std::memset(&h, 0, sizeof h);
+			std::memcpy(h.magic, matrix_file_magic, sizeof h.magic);
+			h.byte_order = matrix_file_byte_order;
+			h.version = matrix_file_version;
+			h.kind = matrix_file_kind<T>();
+			h.elem_size = sizeof(T);
+			h.alignment = matrix_file_alignment;
+			h.rows = rows;
+			h.cols = cols;
+			h.data_offset = (sizeof h + matrix_file_alignment - 1) / matrix_file_alignment * matrix_file_alignment;
+			return h;
+		}
+
+		// Throws unless h describes a T matrix whose data fits in a file of file_size bytes;
+		// returns the size of the data in bytes.
+		template <class T>
+		size_t check_matrix_file_header(const matrix_file_header &h, uint64_t file_size, const std::string &path)
+		{
+			if(std::memcmp(h.magic, matrix_file_magic, sizeof h.magic) != 0)
+				throw std::runtime_error(path + ": not a matrix file");
+			if(h.byte_order != matrix_file_byte_order)
+				throw std::runtime_error(path + ": written with a different byte order");
+			if(h.version > matrix_file_version)
+				throw std::runtime_error(path + ": unsupported version");
+			if(h.kind != matrix_file_kind<T>() || h.elem_size != sizeof(T))
+				throw std::runtime_error(path + ": element type does not match");
+			if(h.data_offset < sizeof h || h.data_offset % alignof(T) != 0)
+				throw std::runtime_error(path + ": bad data offset");
+			if(h.cols != 0 && h.rows > uint64_t(-1) / h.cols / sizeof(T))
+				throw std::runtime_error(path + ": corrupt shape");
+			uint64_t bytes = h.rows * h.cols * sizeof(T);
+			if(file_size < h.data_offset || file_size - h.data_offset < bytes || bytes > size_t(-1))
+				throw std::runtime_error(path + ": truncated");
+			return (size_t)bytes;
+		}
+	}
+
+	template <class T>
+	void save(const ConstMatrixView<T> &v, const std::string &path)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if(!out)
+			throw std::runtime_error(path + ": cannot open for writing");
+		detail::matrix_file_header h = detail::make_matrix_file_header<T>(v.rowLength(), v.columnLength());
+		out.write(reinterpret_cast<const char *>(&h), sizeof h);
+		for(size_t i = sizeof h; i < h.data_offset; i++)
+			out.put('\0');
+		if(v.stride() == v.columnLength())
+			out.write(reinterpret_cast<const char *>(v.data()), v.rowLength() * v.columnLength() * sizeof(T));
+		else
+			for(size_t i = 0; i < v.rowLength(); i++)
+				out.write(reinterpret_cast<const char *>(v.data() + i * v.stride()), v.columnLength() * sizeof(T));
+		out.flush();
+		if(!out)
+			throw std::runtime_error(path + ": write failed");
+	}
+
+	template <class T>
+	void save(const MatrixView<T> &v, const std::string &path)
+	{
+		save(ConstMatrixView<T>(v), path);
+	}
+
+	template <class T, class A>
+	void save(const Matrix<T, A> &m, const std::string &path)
+	{
+		save(m.view(), path);
+	}
+
+	// Reads a file written by save() straight into the new matrix's buffer.
+	template <class T, class A = AlignedAllocator<T>>
+	Matrix<T, A> load(const std::string &path, const A &alloc = A())
+	{
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if(!in)
+			throw std::runtime_error(path + ": cannot open");
+		uint64_t file_size = (uint64_t)in.tellg();
+		in.seekg(0);
+		detail::matrix_file_header h;
+		if(file_size < sizeof h || !in.read(reinterpret_cast<char *>(&h), sizeof h))
+			throw std::runtime_error(path + ": not a matrix file");
+		size_t bytes = detail::check_matrix_file_header<T>(h, file_size, path);
+		Matrix<T, A> m(h.rows, h.cols, detail::uninitialized, alloc);
+		in.seekg(h.data_offset);
+		if(!in.read(reinterpret_cast<char *>(m.view().data()), bytes))
+			throw std::runtime_error(path + ": read failed");
+		return m;
+	}
+
+	// A matrix file mapped into memory. Nothing is read up front: pages are faulted in
+	// from the page cache as they are touched. ReadOnly mappings are shared with every
+	// other process mapping the file; CopyOnWrite ones may be written through
+	// writableView() and never change the file. Move-only; unmapped on destruction.
+	// Without mmap (non-POSIX systems) the file is read into memory instead.
+	template <class T>
+	class MappedMatrix
+	{
+	private:
+		void *base = nullptr;
+		size_t length = 0;
+		T *elem = nullptr;
+		size_t row_size = 0, col_size = 0;
+		MapMode map_mode = MapMode::ReadOnly;
+		std::vector<T> fallback;
+
+		void unmap() noexcept
+		{
+#ifdef SJTU_MATRIX_MMAP
+			if(base != nullptr)
+				munmap(base, length);
+#endif
+			base = nullptr;
+			length = 0;
+		}
+
+	public:
+		MappedMatrix() = default;
+
+		explicit MappedMatrix(const std::string &path, MapMode mode = MapMode::ReadOnly): map_mode(mode)
+		{
+#ifdef SJTU_MATRIX_MMAP
+			int fd = open(path.c_str(), O_RDONLY);
+			if(fd < 0)
+				throw std::runtime_error(path + ": cannot open");
+			struct stat st;
+			if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(detail::matrix_file_header))
+			{
+				close(fd);
+				throw std::runtime_error(path + ": not a matrix file");
+			}
+			length = (size_t)st.st_size;
+			base = mmap(nullptr, length, mode == MapMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+						mode == MapMode::ReadOnly ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+			close(fd);
+			if(base == MAP_FAILED)
+			{
+				base = nullptr;
+				throw std::runtime_error(path + ": mmap failed");
+			}
+			detail::matrix_file_header h;
+			std::memcpy(&h, base, sizeof h);
+			try
+			{
+				detail::check_matrix_file_header<T>(h, length, path);
+			}
+			catch(...)
+			{
+				unmap();
+				throw;
+			}
+			elem = reinterpret_cast<T *>(static_cast<char *>(base) + h.data_offset);
+#else
+			Matrix<T> m = load<T>(path);
+			fallback.assign(m.view().data(), m.view().data() + m.rowLength() * m.columnLength());
+			elem = fallback.data();
+			detail::matrix_file_header h = detail::make_matrix_file_header<T>(m.rowLength(), m.columnLength());
+#endif
+			row_size = h.rows;
+			col_size = h.cols;
+		}
+
+		MappedMatrix(MappedMatrix &&o) noexcept:
+			base(o.base), length(o.length), elem(o.elem), row_size(o.row_size), col_size(o.col_size),
+			map_mode(o.map_mode), fallback(std::move(o.fallback))
+		{
+			o.base = nullptr;
+			o.length = 0;
+			o.elem = nullptr;
+			o.row_size = o.col_size = 0;
+		}
+
+		MappedMatrix &operator=(MappedMatrix &&o) noexcept
+		{
+			if(this == &o)
+				return *this;
+			unmap();
+			base = o.base;
+			length = o.length;
+			elem = o.elem;
+			row_size = o.row_size;
+			col_size = o.col_size;
+			map_mode = o.map_mode;
+			fallback = std::move(o.fallback);
+			o.base = nullptr;
+			o.length = 0;
+			o.elem = nullptr;
+			o.row_size = o.col_size = 0;
+			return *this;
+		}
+
+		MappedMatrix(const MappedMatrix &) = delete;
+
+		MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+		~MappedMatrix()
+		{
+			unmap();
+		}
+
+		MapMode mode() const { return map_mode; }
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::pair<size_t, size_t>(row_size, col_size); }
+
+		const T &operator()(size_t i, size_t j) const noexcept(!detail::checked_access)
+		{
+			if(detail::checked_access)
+				detail::check_index(i, j, row_size, col_size);
+			return elem[i * col_size + j];
+		}
+
+		const T &at(size_t i, size_t j) const
+		{
+			detail::check_index(i, j, row_size, col_size);
+			return elem[i * col_size + j];
+		}
+
+		ConstMatrixView<T> view() const
+		{
+			return ConstMatrixView<T>(elem, row_size, col_size, col_size);
+		}
+
+		MatrixView<T> writableView()
+		{
+			if(map_mode == MapMode::ReadOnly)
+				throw std::invalid_argument("Mapping is read-only");
+			return MatrixView<T>(elem, row_size, col_size, col_size);
+		}
+	};
+
+	template <class T, class Alloc>
+	MappedMatrix<T> Matrix<T, Alloc>::mapFile(const std::string &path, MapMode mode)
+	{
+		return MappedMatrix<T>(path, mode);
+	}
+}
+
+#endif //SJTU_MATRIX_IO_HPP
@@ -0,0 +1,403 @@
+//  reductions.hpp
+//  Sums, extrema, norms and dot products over sjtu::Matrix and its views.
+
+#ifndef SJTU_REDUCTIONS_HPP
+#define SJTU_REDUCTIONS_HPP
+#include "matrix.hpp"
+#include <cmath>
+#include <utility>
+
+namespace sjtu
+{
+	namespace detail
+	{
+		// Sums are pairwise: runs of reduce_block elements are added directly, then halves
+		// are combined recursively, so the rounding error grows with log(n) rather than n.
+		// Work is split into reduce_chunk runs at fixed offsets, so the result does not
+		// depend on the thread count.
+		const size_t reduce_block = 256;
+		const size_t reduce_chunk = size_t(1) << 16;
+
+		// plain sum of a short run, four accumulators to hide latency
+		template <class T>
+		T block_sum(const T *p, size_t n, std::false_type)
+		{
+			T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+			size_t i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				s0 += p[i];
+				s1 += p[i + 1];
+				s2 += p[i + 2];
+				s3 += p[i + 3];
+			}
+			for(; i < n; i++)
+				s0 += p[i];
+			return (s0 + s1) + (s2 + s3);
+		}
+
+		template <class T>
+		T block_dot(const T *a, const T *b, size_t n, std::false_type)
+		{
+			T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+			size_t i = 0;
+			for(; i + 4 <= n; i += 4)
+			{
+				s0 += a[i] * b[i];
+				s1 += a[i + 1] * b[i + 1];
+				s2 += a[i + 2] * b[i + 2];
+				s3 += a[i + 3] * b[i + 3];
+			}
+			for(; i < n; i++)
+				s0 += a[i] * b[i];
+			return (s0 + s1) + (s2 + s3);
+		}
+
+#ifdef SJTU_MATRIX_X86
+		SJTU_MATRIX_FMA inline __m256d reduce_add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+		SJTU_MATRIX_FMA inline __m256 reduce_add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+		SJTU_MATRIX_FMA inline __m256i reduce_add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+
+		// lanes of four vector accumulators, added in a fixed tree
+		template <class T, class V>
+		SJTU_MATRIX_FMA T reduce_lanes(V v0, V v1, V v2, V v3)
+		{
+			const size_t W = 32 / sizeof(T);
+			T lanes[W];
+			gemm_store(lanes, reduce_add(reduce_add(v0, v1), reduce_add(v2, v3)));
+			for(size_t w = W / 2; w > 0; w /= 2)
+				for(size_t i = 0; i < w; i++)
+					lanes[i] += lanes[i + w];
+			return lanes[0];
+		}
+
+		template <class T>
+		SJTU_MATRIX_FMA T block_sum_fma(const T *p, size_t n)
+		{
+			const size_t W = 32 / sizeof(T);
+			auto v0 = gemm_set1(T()), v1 = v0, v2 = v0, v3 = v0;
+			size_t i = 0;
+			for(; i + 4 * W <= n; i += 4 * W)
+			{
+				v0 = reduce_add(v0, gemm_load(p + i));
+				v1 = reduce_add(v1, gemm_load(p + i + W));
+				v2 = reduce_add(v2, gemm_load(p + i + 2 * W));
+				v3 = reduce_add(v3, gemm_load(p + i + 3 * W));
+			}
+			T s = reduce_lanes<T>(v0, v1, v2, v3);
+			for(; i < n; i++)
+				s += p[i];
+			return s;
+		}
+
+		template <class T>
+		SJTU_MATRIX_FMA T block_dot_fma(const T *a, const T *b, size_t n)
+		{
+			const size_t W = 32 / sizeof(T);
+			auto v0 = gemm_set1(T()), v1 = v0, v2 = v0, v3 = v0;
+			size_t i = 0;
+			for(; i + 4 * W <= n; i += 4 * W)
+			{
+				v0 = gemm_madd(gemm_load(a + i), gemm_load(b + i), v0);
+				v1 = gemm_madd(gemm_load(a + i + W), gemm_load(b + i + W), v1);
+				v2 = gemm_madd(gemm_load(a + i + 2 * W), gemm_load(b + i + 2 * W), v2);
+				v3 = gemm_madd(gemm_load(a + i + 3 * W), gemm_load(b + i + 3 * W), v3);
+			}
+			T s = reduce_lanes<T>(v0, v1, v2, v3);
+			for(; i < n; i++)
+				s += a[i] * b[i];
+			return s;
+		}
+
+		template <class T>
+		T block_sum(const T *p, size_t n, std::true_type)
+		{
+			return cpu_has_fma() ? block_sum_fma(p, n) : block_sum(p, n, std::false_type());
+		}
+
+		template <class T>
+		T block_dot(const T *a, const T *b, size_t n, std::true_type)
+		{
+			return cpu_has_fma() ? block_dot_fma(a, b, n) : block_dot(a, b, n, std::false_type());
+		}
+#endif
+
+		template <class T>
+		T pairwise_sum(const T *p, size_t n)
+		{
+			if(n <= reduce_block)
+				return block_sum(p, n, gemm_vector_tile<T>());
+			size_t h = (n / 2 + reduce_block - 1) / reduce_block * reduce_block;
+			return pairwise_sum(p, h) + pairwise_sum(p + h, n - h);
+		}
+
+		template <class T>
+		T pairwise_dot(const T *a, const T *b, size_t n)
+		{
+			if(n <= reduce_block)
+				return block_dot(a, b, n, gemm_vector_tile<T>());
+			size_t h = (n / 2 + reduce_block - 1) / reduce_block * reduce_block;
+			return pairwise_dot(a, b, h) + pairwise_dot(a + h, b + h, n - h);
+		}
+
+		// Splits a rows x cols matrix into runs of at most reduce_chunk elements of one row
+		// (a contiguous matrix counts as a single row) and returns f(row, first column,
+		// length) for every run, computed in parallel. Rows shorter than reduce_chunk are
+		// taken a fixed group at a time instead, the group's runs reduced by merge(results,
+		// count), so there are about elements / reduce_chunk partials whatever the shape,
+		// and the grouping never depends on the number of threads.
+		template <class R, class F, class M>
+		std::vector<R> reduce_runs(size_t rows, size_t cols, bool contiguous, const F &f, const M &merge)
+		{
+			if(contiguous)
+			{
+				cols *= rows;
+				rows = cols == 0 ? 0 : 1;
+			}
+			size_t per_row = (cols + reduce_chunk - 1) / reduce_chunk;
+			size_t group = cols == 0 ? 1 : std::max(size_t(1), reduce_chunk / cols);
+			std::vector<R> partial(group > 1 ? (rows + group - 1) / group : rows * per_row);
+			size_t run = std::max(size_t(1), std::min(cols, reduce_chunk) * group);
+			parallel_for(partial.size(), std::max(size_t(1), parallel_grain / run), [&](size_t lo, size_t hi) {
+				std::vector<R> rows_here(group > 1 ? group : 0);
+				for(size_t r = lo; r < hi; r++)
+				{
+					if(group == 1)
+					{
+						size_t i = r / per_row, j = r % per_row * reduce_chunk;
+						partial[r] = f(i, j, std::min(reduce_chunk, cols - j));
+						continue;
+					}
+					size_t i0 = r * group, n = std::min(group, rows - i0);
+					for(size_t t = 0; t < n; t++)
+						rows_here[t] = f(i0 + t, size_t(0), cols);
+					partial[r] = merge(rows_here.data(), n);
+				}
+			});
+			return partial;
+		}
+
+		// First position of the smallest element under less (the largest, for a flipped less).
+		template <class T, class Less>
+		std::pair<size_t, size_t> arg_extreme(const ConstMatrixView<T> &v, const Less &less)
+		{
+			if(v.rowLength() == 0 || v.columnLength() == 0)
+				throw std::invalid_argument("Matrix is empty");
+			size_t cols = v.columnLength(), ld = v.stride();
+			bool contiguous = ld == cols;
+			const T *p = v.data();
+			// the first of n candidate positions, in row-major order, holding the extreme value
+			auto pick = [&](const size_t *best, size_t n) {
+				size_t k = best[0];
+				for(size_t r = 1; r < n; r++)
+					if(less(p[best[r] / cols * ld + best[r] % cols], p[k / cols * ld + k % cols]))
+						k = best[r];
+				return k;
+			};
+			std::vector<size_t> best = reduce_runs<size_t>(v.rowLength(), cols, contiguous, [&](size_t i, size_t j, size_t n) {
+				const T *q = p + (contiguous ? 0 : i * ld) + j;
+				size_t k = 0;
+				for(size_t t = 1; t < n; t++)
+					if(less(q[t], q[k]))
+						k = t;
+				return contiguous ? j + k : i * cols + j + k;
+			}, pick);
+			size_t k = pick(best.data(), best.size());
+			return std::make_pair(k / cols, k % cols);
+		}
+	}
+
+	template <class T>
+	T sum(const ConstMatrixView<T> &v)
+	{
+		size_t ld = v.stride();
+		bool contiguous = ld == v.columnLength();
+		std::vector<T> partial = detail::reduce_runs<T>(v.rowLength(), v.columnLength(), contiguous, [&](size_t i, size_t j, size_t n) {
+			return detail::pairwise_sum(v.data() + (contiguous ? 0 : i * ld) + j, n);
+		}, detail::pairwise_sum<T>);
+		return detail::pairwise_sum(partial.data(), partial.size());
+	}
+
+	// sum of a(i, j) * b(i, j), the Frobenius inner product
+	template <class T>
+	T dot(const ConstMatrixView<T> &a, const ConstMatrixView<T> &b)
+	{
+		if(a.rowLength() != b.rowLength() || a.columnLength() != b.columnLength())
+			throw std::invalid_argument("Size cannot match");
+		size_t lda = a.stride(), ldb = b.stride();
+		bool contiguous = lda == a.columnLength() && ldb == b.columnLength();
+		std::vector<T> partial = detail::reduce_runs<T>(a.rowLength(), a.columnLength(), contiguous, [&](size_t i, size_t j, size_t n) {
+			return contiguous ? detail::pairwise_dot(a.data() + j, b.data() + j, n)
+							  : detail::pairwise_dot(a.data() + i * lda + j, b.data() + i * ldb + j, n);
+		}, detail::pairwise_sum<T>);
+		return detail::pairwise_sum(partial.data(), partial.size());
+	}
+
+	namespace detail
+	{
+		template <class T>
+		T sum_squares(const ConstMatrixView<T> &v, std::true_type)
+		{
+			return dot(v, v);
+		}
+
+		// integers are squared and summed in double, where they cannot overflow
+		template <class T>
+		double sum_squares(const ConstMatrixView<T> &v, std::false_type)
+		{
+			size_t ld = v.stride();
+			bool contiguous = ld == v.columnLength();
+			std::vector<double> partial = reduce_runs<double>(v.rowLength(), v.columnLength(), contiguous, [&](size_t i, size_t j, size_t n) {
+				const T *p = v.data() + (contiguous ? 0 : i * ld) + j;
+				double s = 0;
+				for(size_t t = 0; t < n; t++)
+					s += (double)p[t] * (double)p[t];
+				return s;
+			}, pairwise_sum<double>);
+			return pairwise_sum(partial.data(), partial.size());
+		}
+	}
+
+	// Frobenius norm; integer matrices give a double
+	template <class T>
+	auto norm(const ConstMatrixView<T> &v)
+	{
+		return std::sqrt(detail::sum_squares(v, std::is_floating_point<T>()));
+	}
+
+	template <class T>
+	T min(const ConstMatrixView<T> &v)
+	{
+		std::pair<size_t, size_t> k = detail::arg_extreme(v, [](const T &x, const T &y) { return x < y; });
+		return v(k.first, k.second);
+	}
+
+	template <class T>
+	T max(const ConstMatrixView<T> &v)
+	{
+		std::pair<size_t, size_t> k = detail::arg_extreme(v, [](const T &x, const T &y) { return y < x; });
+		return v(k.first, k.second);
+	}
+
+	// (row, column) of the first smallest element
+	template <class T>
+	std::pair<size_t, size_t> argmin(const ConstMatrixView<T> &v)
+	{
+		return detail::arg_extreme(v, [](const T &x, const T &y) { return x < y; });
+	}
+
+	// (row, column) of the first largest element
+	template <class T>
+	std::pair<size_t, size_t> argmax(const ConstMatrixView<T> &v)
+	{
+		return detail::arg_extreme(v, [](const T &x, const T &y) { return y < x; });
+	}
+
+	// the n x 1 column of row sums
+	template <class T>
+	Matrix<T> rowSums(const ConstMatrixView<T> &v)
+	{
+		Matrix<T> tmp(v.rowLength(), 1);
+		detail::parallel_for(v.rowLength(), std::max(size_t(1), detail::parallel_grain / std::max(v.columnLength(), size_t(1))), [&](size_t lo, size_t hi) {
+			for(size_t i = lo; i < hi; i++)
+				tmp(i, 0) = detail::pairwise_sum(v.data() + i * v.stride(), v.columnLength());
+		});
+		return tmp;
+	}
+
+	namespace detail
+	{
+		// sum[j - lo] = v(r, j) summed over rows [r0, r1), for columns [lo, hi), pairwise over rows
+		template <class T>
+		void column_sums(const ConstMatrixView<T> &v, size_t r0, size_t r1, size_t lo, size_t hi, T *sum)
+		{
+			if(r1 - r0 <= reduce_block)
+			{
+				std::fill(sum, sum + (hi - lo), T());
+				for(size_t i = r0; i < r1; i++)
+				{
+					const T *row = v.data() + i * v.stride();
+					for(size_t j = lo; j < hi; j++)
+						sum[j - lo] += row[j];
+				}
+				return;
+			}
+			size_t h = r0 + (r1 - r0) / 2;
+			std::vector<T> upper(hi - lo);
+			column_sums(v, r0, h, lo, hi, upper.data());
+			column_sums(v, h, r1, lo, hi, sum);
+			for(size_t j = 0; j < hi - lo; j++)
+				sum[j] = upper[j] + sum[j];
+		}
+	}
+
+	// the 1 x m row of column sums
+	template <class T>
+	Matrix<T> colSums(const ConstMatrixView<T> &v)
+	{
+		Matrix<T> tmp(1, v.columnLength());
+		if(v.rowLength() == 0)
+			return tmp;
+		detail::parallel_for(v.columnLength(), std::max(size_t(64), detail::parallel_grain / v.rowLength()), [&](size_t lo, size_t hi) {
+			detail::column_sums(v, 0, v.rowLength(), lo, hi, tmp.data() + lo);
+		});
+		return tmp;
+	}
+
+	// the same for matrices and writable views
+	template <class T, class A>
+	T sum(const Matrix<T, A> &m) { return sum(m.view()); }
+
+	template <class T>
+	T sum(const MatrixView<T> &v) { return sum(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	auto norm(const Matrix<T, A> &m) { return norm(m.view()); }
+
+	template <class T>
+	auto norm(const MatrixView<T> &v) { return norm(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	T min(const Matrix<T, A> &m) { return min(m.view()); }
+
+	template <class T>
+	T min(const MatrixView<T> &v) { return min(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	T max(const Matrix<T, A> &m) { return max(m.view()); }
+
+	template <class T>
+	T max(const MatrixView<T> &v) { return max(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	std::pair<size_t, size_t> argmin(const Matrix<T, A> &m) { return argmin(m.view()); }
+
+	template <class T>
+	std::pair<size_t, size_t> argmin(const MatrixView<T> &v) { return argmin(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	std::pair<size_t, size_t> argmax(const Matrix<T, A> &m) { return argmax(m.view()); }
+
+	template <class T>
+	std::pair<size_t, size_t> argmax(const MatrixView<T> &v) { return argmax(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	Matrix<T> rowSums(const Matrix<T, A> &m) { return rowSums(m.view()); }
+
+	template <class T>
+	Matrix<T> rowSums(const MatrixView<T> &v) { return rowSums(ConstMatrixView<T>(v)); }
+
+	template <class T, class A>
+	Matrix<T> colSums(const Matrix<T, A> &m) { return colSums(m.view()); }
+
+	template <class T>
+	Matrix<T> colSums(const MatrixView<T> &v) { return colSums(ConstMatrixView<T>(v)); }
+
+	template <class T, class A, class B>
+	T dot(const Matrix<T, A> &a, const Matrix<T, B> &b) { return dot(a.view(), b.view()); }
+
+	template <class T>
+	T dot(const MatrixView<T> &a, const MatrixView<T> &b) { return dot(ConstMatrixView<T>(a), ConstMatrixView<T>(b)); }
+}
+
+#endif //SJTU_REDUCTIONS_HPP
@@ -0,0 +1,511 @@
+//  sparse_matrix.hpp
+//  Compressed sparse row / column matrices that interoperate with sjtu::Matrix.
+
+#ifndef SJTU_SPARSE_MATRIX_HPP
+#define SJTU_SPARSE_MATRIX_HPP
+#include "matrix.hpp"
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+namespace sjtu
+{
+	// CSR keeps each row's nonzeros together (fast row access, SpMV, sparse * dense);
+	// CSC keeps each column's together. Both need O(rows + columns + nonzeros) memory.
+	enum class SparseFormat { CSR, CSC };
+
+	// Only nonzeros are stored: for the outer dimension o (a row in CSR, a column in CSC)
+	// the entries live in [start[o], start[o + 1]) of inner (their column or row, sorted)
+	// and values. Explicit zeros never appear in the structure.
+	template <class T>
+	class SparseMatrix
+	{
+		template <class> friend class SparseMatrix;
+
+	private:
+		size_t row_size = 0, col_size = 0;
+		SparseFormat fmt = SparseFormat::CSR;
+		std::vector<size_t> start;
+		std::vector<size_t> inner;
+		std::vector<T> values;
+
+		size_t outerSize() const { return fmt == SparseFormat::CSR ? row_size : col_size; }
+
+		size_t innerSize() const { return fmt == SparseFormat::CSR ? col_size : row_size; }
+
+		// Builds the structure from (outer, inner, value) triples in any order,
+		// summing duplicates and dropping entries that end up zero.
+		void compress(std::vector<std::tuple<size_t, size_t, T>> &t)
+		{
+			std::sort(t.begin(), t.end(), [](const std::tuple<size_t, size_t, T> &x, const std::tuple<size_t, size_t, T> &y) {
+				return std::get<0>(x) != std::get<0>(y) ? std::get<0>(x) < std::get<0>(y) : std::get<1>(x) < std::get<1>(y);
+			});
+			start.assign(outerSize() + 1, 0);
+			inner.clear();
+			values.clear();
+			for(size_t i = 0; i < t.size();)
+			{
+				size_t o = std::get<0>(t[i]), in = std::get<1>(t[i]);
+				T sum = std::get<2>(t[i]);
+				for(i++; i < t.size() && std::get<0>(t[i]) == o && std::get<1>(t[i]) == in; i++)
+					sum += std::get<2>(t[i]);
+				if(sum == T())
+					continue;
+				inner.push_back(in);
+				values.push_back(sum);
+				start[o + 1]++;
+			}
+			for(size_t o = 0; o < outerSize(); o++)
+				start[o + 1] += start[o];
+		}
+
+	public:
+		using value_type = T;
+
+		template <bool Const>
+		class basic_iterator
+		{
+			friend class SparseMatrix;
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type        = T;
+			using pointer           = typename std::conditional<Const, const T *, T *>::type;
+			using reference         = typename std::conditional<Const, const T &, T &>::type;
+			using difference_type   = std::ptrdiff_t;
+
+		private:
+			typedef typename std::conditional<Const, const SparseMatrix *, SparseMatrix *>::type owner;
+			owner p = nullptr;
+			size_t k = 0, outer = 0;
+
+			basic_iterator(owner p, size_t k, size_t outer = 0): p(p), k(k), outer(outer)
+			{
+				skipEmpty();
+			}
+
+			void skipEmpty()
+			{
+				while(outer < p->outerSize() && p->start[outer + 1] <= k)
+					outer++;
+			}
+
+		public:
+			basic_iterator() = default;
+
+			basic_iterator(const basic_iterator<false> &o): p(o.p), k(o.k), outer(o.outer) {}
+
+			size_t row() const { return p->fmt == SparseFormat::CSR ? outer : p->inner[k]; }
+
+			size_t column() const { return p->fmt == SparseFormat::CSR ? p->inner[k] : outer; }
+
+			reference operator*() const { return p->values[k]; }
+
+			pointer operator->() const { return &p->values[k]; }
+
+			basic_iterator &operator++()
+			{
+				k++;
+				skipEmpty();
+				return *this;
+			}
+
+			basic_iterator operator++(int)
+			{
+				basic_iterator tmp = *this;
+				++*this;
+				return tmp;
+			}
+
+			bool operator==(const basic_iterator &o) const { return p == o.p && k == o.k; }
+
+			bool operator!=(const basic_iterator &o) const { return !(*this == o); }
+
+			template <bool> friend class basic_iterator;
+		};
+
+		using iterator = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+
+		SparseMatrix() = default;
+
+		SparseMatrix(size_t n, size_t m, SparseFormat f = SparseFormat::CSR): row_size(n), col_size(m), fmt(f)
+		{
+			start.assign(outerSize() + 1, 0);
+		}
+
+		// entries are (row, column, value); duplicates are summed
+		SparseMatrix(size_t n, size_t m, const std::vector<std::tuple<size_t, size_t, T>> &entries,
+					 SparseFormat f = SparseFormat::CSR): row_size(n), col_size(m), fmt(f)
+		{
+			std::vector<std::tuple<size_t, size_t, T>> t;
+			t.reserve(entries.size());
+			for(auto &e : entries)
+			{
+				if(!(std::get<0>(e) < n && std::get<1>(e) < m))
+					throw std::invalid_argument("Out of range");
+				if(f == SparseFormat::CSR)
+					t.emplace_back(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+				else
+					t.emplace_back(std::get<1>(e), std::get<0>(e), std::get<2>(e));
+			}
+			compress(t);
+		}
+
+		template <class U, class A>
+		explicit SparseMatrix(const Matrix<U, A> &o, SparseFormat f = SparseFormat::CSR):
+			row_size(o.rowLength()), col_size(o.columnLength()), fmt(f)
+		{
+			ConstMatrixView<U> v = o.view();
+			start.assign(outerSize() + 1, 0);
+			for(size_t oi = 0; oi < outerSize(); oi++)
+			{
+				for(size_t ii = 0; ii < innerSize(); ii++)
+				{
+					T x = (T)(f == SparseFormat::CSR ? v.data()[oi * v.stride() + ii] : v.data()[ii * v.stride() + oi]);
+					if(x == T())
+						continue;
+					inner.push_back(ii);
+					values.push_back(x);
+				}
+				start[oi + 1] = inner.size();
+			}
+		}
+
+		// converts every value to T, dropping those that become zero (0.25 as an int)
+		template <class U>
+		SparseMatrix(const SparseMatrix<U> &o): row_size(o.row_size), col_size(o.col_size), fmt(o.fmt)
+		{
+			start.assign(outerSize() + 1, 0);
+			inner.reserve(o.inner.size());
+			values.reserve(o.values.size());
+			for(size_t oi = 0; oi < outerSize(); oi++)
+			{
+				for(size_t k = o.start[oi]; k < o.start[oi + 1]; k++)
+				{
+					T x = (T)o.values[k];
+					if(x == T())
+						continue;
+					inner.push_back(o.inner[k]);
+					values.push_back(x);
+				}
+				start[oi + 1] = inner.size();
+			}
+		}
+
+		SparseFormat format() const { return fmt; }
+
+		size_t rowLength() const { return row_size; }
+
+		size_t columnLength() const { return col_size; }
+
+		std::pair<size_t, size_t> size() const { return std::pair<size_t, size_t>(row_size, col_size); }
+
+		// number of stored entries
+		size_t nonZeros() const { return values.size(); }
+
+		// the value at (i, j), zero when nothing is stored there
+		T operator()(size_t i, size_t j) const
+		{
+			if(!(i < row_size && j < col_size))
+				throw std::invalid_argument("Out of range");
+			size_t o = fmt == SparseFormat::CSR ? i : j, in = fmt == SparseFormat::CSR ? j : i;
+			auto first = inner.begin() + start[o], last = inner.begin() + start[o + 1];
+			auto it = std::lower_bound(first, last, in);
+			return it != last && *it == in ? values[it - inner.begin()] : T();
+		}
+
+		// The same matrix stored in format f; converting between CSR and CSC is a
+		// counting sort of the nonzeros, O(rows + columns + nonzeros).
+		SparseMatrix toFormat(SparseFormat f) const
+		{
+			if(f == fmt)
+				return *this;
+			SparseMatrix tmp(row_size, col_size, f);
+			size_t outer = outerSize(), n = tmp.outerSize();
+			for(size_t in : inner)
+				tmp.start[in + 1]++;
+			for(size_t o = 0; o < n; o++)
+				tmp.start[o + 1] += tmp.start[o];
+			tmp.inner.resize(inner.size());
+			tmp.values.resize(values.size());
+			std::vector<size_t> pos(tmp.start.begin(), tmp.start.end() - 1);
+			for(size_t o = 0; o < outer; o++)
+				for(size_t k = start[o]; k < start[o + 1]; k++)
+				{
+					size_t &q = pos[inner[k]];
+					tmp.inner[q] = o;
+					tmp.values[q] = values[k];
+					q++;
+				}
+			return tmp;
+		}
+
+		// The transpose shares the same arrays: a CSR matrix read as CSC is its transpose.
+		SparseMatrix tran() const
+		{
+			SparseMatrix tmp(*this);
+			std::swap(tmp.row_size, tmp.col_size);
+			tmp.fmt = fmt == SparseFormat::CSR ? SparseFormat::CSC : SparseFormat::CSR;
+			return tmp;
+		}
+
+		Matrix<T> toDense() const
+		{
+			return Matrix<T>(*this);
+		}
+
+		template <class U>
+		bool operator==(const SparseMatrix<U> &o) const
+		{
+			if(row_size != o.row_size || col_size != o.col_size)
+				return false;
+			if(fmt != o.fmt)
+				return *this == o.toFormat(fmt);
+			if(start != o.start || inner != o.inner)
+				return false;
+			for(size_t k = 0; k < values.size(); k++)
+				if(values[k] != o.values[k])
+					return false;
+			return true;
+		}
+
+		template <class U>
+		bool operator!=(const SparseMatrix<U> &o) const
+		{
+			return !(*this == o);
+		}
+
+		template <class U, class = detail::enable_scalar<U>>
+		SparseMatrix &operator*=(const U &x)
+		{
+			if(x == U())
+				return *this = SparseMatrix(row_size, col_size, fmt);
+			// products can still underflow or truncate to zero, which must not stay stored
+			size_t kept = 0, k = 0;
+			for(size_t o = 0; o < outerSize(); o++)
+			{
+				for(; k < start[o + 1]; k++)
+				{
+					T v = values[k];
+					v *= x;
+					if(v == T())
+						continue;
+					inner[kept] = inner[k];
+					values[kept++] = v;
+				}
+				start[o + 1] = kept;
+			}
+			inner.resize(kept);
+			values.resize(kept);
+			return *this;
+		}
+
+		iterator begin() { return iterator(this, 0); }
+
+		iterator end() { return iterator(this, values.size()); }
+
+		const_iterator begin() const { return const_iterator(this, 0); }
+
+		const_iterator end() const { return const_iterator(this, values.size()); }
+
+		const_iterator cbegin() const { return begin(); }
+
+		const_iterator cend() const { return end(); }
+
+		// the nonzeros of row o (CSR) or column o (CSC) are [outerBegin(o), outerEnd(o))
+		const_iterator outerBegin(size_t o) const { return const_iterator(this, start[o], o); }
+
+		const_iterator outerEnd(size_t o) const { return const_iterator(this, start[o + 1], o); }
+
+		// a +/- b merged outer slice by outer slice, in a's format
+		template <int OP, class U, class V>
+		static SparseMatrix combine(const SparseMatrix<U> &a, const SparseMatrix<V> &bo)
+		{
+			if(a.row_size != bo.row_size || a.col_size != bo.col_size)
+				throw std::invalid_argument("Size cannot match");
+			SparseMatrix<V> conv;
+			const SparseMatrix<V> &b = bo.fmt == a.fmt ? bo : (conv = bo.toFormat(a.fmt));
+			SparseMatrix tmp(a.row_size, a.col_size, a.fmt);
+			tmp.inner.reserve(a.nonZeros() + b.nonZeros());
+			tmp.values.reserve(a.nonZeros() + b.nonZeros());
+			auto push = [&](size_t in, const T &x) {
+				if(x == T())
+					return;
+				tmp.inner.push_back(in);
+				tmp.values.push_back(x);
+			};
+			for(size_t o = 0; o < a.outerSize(); o++)
+			{
+				size_t i = a.start[o], j = b.start[o];
+				while(i < a.start[o + 1] || j < b.start[o + 1])
+				{
+					if(j == b.start[o + 1] || (i < a.start[o + 1] && a.inner[i] < b.inner[j]))
+						push(a.inner[i], (T)a.values[i]), i++;
+					else if(i == a.start[o + 1] || b.inner[j] < a.inner[i])
+						push(b.inner[j], detail::ew_scalar<OP>::apply(T(), (T)b.values[j])), j++;
+					else
+						push(a.inner[i], detail::ew_scalar<OP>::apply((T)a.values[i], (T)b.values[j])), i++, j++;
+				}
+				tmp.start[o + 1] = tmp.inner.size();
+			}
+			return tmp;
+		}
+
+		// a * b in CSR by Gustavson's row-by-row algorithm with a dense accumulator. Rows come
+		// out in order, so only each row's columns need sorting before they are appended.
+		template <class U, class V>
+		static SparseMatrix multiply(const SparseMatrix<U> &ao, const SparseMatrix<V> &bo)
+		{
+			if(ao.col_size != bo.row_size)
+				throw std::invalid_argument("Size cannot match");
+			SparseMatrix<U> aconv;
+			SparseMatrix<V> bconv;
+			const SparseMatrix<U> &a = ao.fmt == SparseFormat::CSR ? ao : (aconv = ao.toFormat(SparseFormat::CSR));
+			const SparseMatrix<V> &b = bo.fmt == SparseFormat::CSR ? bo : (bconv = bo.toFormat(SparseFormat::CSR));
+			size_t n = b.col_size;
+			SparseMatrix tmp(a.row_size, n);
+			std::vector<T> acc(n);
+			std::vector<size_t> mark(n, size_t(-1)), cols;
+			for(size_t i = 0; i < a.row_size; i++)
+			{
+				cols.clear();
+				for(size_t p = a.start[i]; p < a.start[i + 1]; p++)
+				{
+					const U &x = a.values[p];
+					size_t k = a.inner[p];
+					for(size_t q = b.start[k]; q < b.start[k + 1]; q++)
+					{
+						size_t j = b.inner[q];
+						if(mark[j] != i)
+						{
+							mark[j] = i;
+							acc[j] = T();
+							cols.push_back(j);
+						}
+						acc[j] += x * b.values[q];
+					}
+				}
+				std::sort(cols.begin(), cols.end());
+				for(size_t j : cols)
+					if(acc[j] != T())
+					{
+						tmp.inner.push_back(j);
+						tmp.values.push_back(acc[j]);
+					}
+				tmp.start[i + 1] = tmp.inner.size();
+			}
+			return tmp;
+		}
+
+		// c (rows x n, leading dimension ldc) += (*this) * b (columns x n, leading dimension ldb).
+		// CSR rows are independent and run in parallel; CSC scatters into rows, so it stays serial.
+		template <class R, class V>
+		void multiplyDense(const V *b, size_t ldb, size_t n, R *c, size_t ldc) const
+		{
+			if(fmt == SparseFormat::CSR)
+			{
+				detail::parallel_for(row_size, std::max(size_t(1), detail::parallel_grain / std::max(size_t(1), n)),
+									 [&](size_t lo, size_t hi) {
+					for(size_t i = lo; i < hi; i++)
+						for(size_t k = start[i]; k < start[i + 1]; k++)
+						{
+							const V *src = b + inner[k] * ldb;
+							R x = values[k];
+							for(size_t j = 0; j < n; j++)
+								c[i * ldc + j] += x * src[j];
+						}
+				});
+				return;
+			}
+			for(size_t o = 0; o < col_size; o++)
+				for(size_t k = start[o]; k < start[o + 1]; k++)
+				{
+					const V *src = b + o * ldb;
+					R x = values[k];
+					for(size_t j = 0; j < n; j++)
+						c[inner[k] * ldc + j] += x * src[j];
+				}
+		}
+	};
+
+	template <class U, class V>
+	auto operator+(const SparseMatrix<U> &a, const SparseMatrix<V> &b)
+	{
+		return SparseMatrix<decltype(U() * V())>::template combine<detail::ew_add>(a, b);
+	}
+
+	template <class U, class V>
+	auto operator-(const SparseMatrix<U> &a, const SparseMatrix<V> &b)
+	{
+		return SparseMatrix<decltype(U() * V())>::template combine<detail::ew_sub>(a, b);
+	}
+
+	template <class T, class U, class = detail::enable_scalar<U>>
+	auto operator*(const SparseMatrix<T> &a, const U &x)
+	{
+		SparseMatrix<decltype(T() * U())> tmp(a);
+		tmp *= x;
+		return tmp;
+	}
+
+	template <class T, class U, class = detail::enable_scalar<U>>
+	auto operator*(const U &x, const SparseMatrix<T> &a)
+	{
+		return a * x;
+	}
+
+	// SpMV
+	template <class U, class V>
+	auto operator*(const SparseMatrix<U> &a, const std::vector<V> &x)
+	{
+		if(a.columnLength() != x.size())
+			throw std::invalid_argument("Size cannot match");
+		std::vector<decltype(U() * V())> y(a.rowLength());
+		a.multiplyDense(x.data(), 1, 1, y.data(), 1);
+		return y;
+	}
+
+	// SpMM with a dense right-hand side
+	template <class U, class V, class B>
+	auto operator*(const SparseMatrix<U> &a, const Matrix<V, B> &b)
+	{
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		Matrix<decltype(U() * V())> tmp(a.rowLength(), b.columnLength());
+		ConstMatrixView<V> v = b.view();
+		a.multiplyDense(v.data(), v.stride(), b.columnLength(), tmp.view().data(), b.columnLength());
+		return tmp;
+	}
+
+	// dense * sparse: every row of the result walks all nonzeros of b once
+	template <class U, class A, class V>
+	auto operator*(const Matrix<U, A> &a, const SparseMatrix<V> &b)
+	{
+		if(a.columnLength() != b.rowLength())
+			throw std::invalid_argument("Size cannot match");
+		typedef decltype(U() * V()) R;
+		Matrix<R> tmp(a.rowLength(), b.columnLength());
+		ConstMatrixView<U> v = a.view();
+		R *c = tmp.view().data();
+		size_t n = b.columnLength();
+		detail::parallel_for(a.rowLength(), std::max(size_t(1), detail::parallel_grain / std::max(size_t(1), b.nonZeros())),
+							 [&](size_t lo, size_t hi) {
+			for(size_t i = lo; i < hi; i++)
+			{
+				const U *row = v.data() + i * v.stride();
+				for(auto it = b.begin(); it != b.end(); ++it)
+					c[i * n + it.column()] += row[it.row()] * *it;
+			}
+		});
+		return tmp;
+	}
+
+	// sparse * sparse; the result is CSR
+	template <class U, class V>
+	auto operator*(const SparseMatrix<U> &a, const SparseMatrix<V> &b)
+	{
+		return SparseMatrix<decltype(U() * V())>::multiply(a, b);
+	}
+}
+
+#endif //SJTU_SPARSE_MATRIX_HPP
@@ -0,0 +1,229 @@
+//  thread_pool.hpp
+//  A small reusable pool used by sjtu::Matrix for its parallel kernels.
+
+#ifndef SJTU_THREAD_POOL_HPP
+#define SJTU_THREAD_POOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu
+{
+	// Workers sleep until run() publishes a batch of tasks, then every worker
+	// (and the calling thread) keeps claiming the next unfinished index until the
+	// batch is drained, so a slow task never leaves the other threads idle.
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mtx, run_mtx;
+		std::condition_variable wake, finished;
+		const std::function<void(size_t)> *job = nullptr;
+		size_t task_count = 0;
+		size_t generation = 0;
+		std::atomic<size_t> next{0};
+		size_t done = 0;
+		size_t active = 0;
+		bool stopping = false;
+		std::exception_ptr error;
+
+		static bool &insideTask()
+		{
+			static thread_local bool flag = false;
+			return flag;
+		}
+
+		void drain(const std::function<void(size_t)> &fn, size_t tasks)
+		{
+			size_t finished_here = 0;
+			for(size_t i = next++; i < tasks; i = next++)
+			{
+				try
+				{
+					fn(i);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					if(!error)
+						error = std::current_exception();
+				}
+				finished_here++;
+			}
+			if(finished_here == 0)
+				return;
+			std::lock_guard<std::mutex> lock(mtx);
+			done += finished_here;
+			if(done == tasks)
+				finished.notify_all();
+		}
+
+		void workerLoop()
+		{
+			insideTask() = true;
+			size_t seen = 0;
+			while(true)
+			{
+				const std::function<void(size_t)> *fn;
+				size_t tasks;
+				{
+					std::unique_lock<std::mutex> lock(mtx);
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if(stopping)
+						return;
+					seen = generation;
+					if(job == nullptr)
+						continue;
+					fn = job;
+					tasks = task_count;
+					active++;
+				}
+				drain(*fn, tasks);
+				std::lock_guard<std::mutex> lock(mtx);
+				if(--active == 0)
+					finished.notify_all();
+			}
+		}
+
+	public:
+		explicit ThreadPool(size_t threads)
+		{
+			for(size_t i = 1; i < threads; i++)
+				workers.emplace_back([this] { workerLoop(); });
+		}
+
+		ThreadPool(const ThreadPool &) = delete;
+
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				stopping = true;
+			}
+			wake.notify_all();
+			for(auto &t : workers)
+				t.join();
+		}
+
+		// number of threads taking part in run(), including the caller
+		size_t size() const { return workers.size() + 1; }
+
+		// Calls fn(0) ... fn(tasks - 1) across the pool and returns once all of them
+		// finished, rethrowing the first exception. Nested calls from inside a task run inline.
+		void run(size_t tasks, const std::function<void(size_t)> &fn)
+		{
+			if(tasks == 0)
+				return;
+			if(workers.empty() || tasks == 1 || insideTask())
+			{
+				for(size_t i = 0; i < tasks; i++)
+					fn(i);
+				return;
+			}
+			std::lock_guard<std::mutex> serial(run_mtx);
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				job = &fn;
+				task_count = tasks;
+				done = 0;
+				error = nullptr;
+				next = 0;
+				generation++;
+			}
+			wake.notify_all();
+			insideTask() = true;
+			drain(fn, tasks);
+			insideTask() = false;
+			std::exception_ptr failed;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				finished.wait(lock, [&] { return done == tasks && active == 0; });
+				job = nullptr;
+				failed = error;
+			}
+			if(failed)
+				std::rethrow_exception(failed);
+		}
+	};
+
+	namespace detail
+	{
+		inline size_t &thread_count()
+		{
+			static size_t n = 1;
+			return n;
+		}
+
+		inline std::unique_ptr<ThreadPool> &global_pool()
+		{
+			static std::unique_ptr<ThreadPool> pool;
+			return pool;
+		}
+
+		inline std::mutex &pool_mutex()
+		{
+			static std::mutex m;
+			return m;
+		}
+
+		// Only reads the pool: setThreadCount builds it before thread_count() can exceed 1,
+		// so threads starting their first parallel operation together share one pool.
+		inline ThreadPool &pool()
+		{
+			return *global_pool();
+		}
+
+		// Splits [0, n) into chunks of at least grain elements and calls f(lo, hi) on each,
+		// in parallel when more than one thread is configured.
+		template <class F>
+		void parallel_for(size_t n, size_t grain, const F &f)
+		{
+			size_t threads = thread_count();
+			if(threads <= 1 || n < 2 * grain)
+			{
+				if(n != 0)
+					f(size_t(0), n);
+				return;
+			}
+			size_t tasks = std::min(threads * 4, (n + grain - 1) / grain);
+			size_t chunk = (n + tasks - 1) / tasks;
+			tasks = (n + chunk - 1) / chunk;
+			pool().run(tasks, [&](size_t t) {
+				size_t lo = t * chunk, hi = std::min(n, lo + chunk);
+				f(lo, hi);
+			});
+		}
+	}
+
+	// Opt-in parallelism for all Matrix kernels: 1 (the default) keeps everything on the
+	// calling thread, 0 uses every hardware thread. Must not be changed while another
+	// thread is inside a Matrix operation, since the old pool is destroyed here.
+	inline void setThreadCount(size_t n)
+	{
+		if(n == 0)
+			n = std::max(1u, std::thread::hardware_concurrency());
+		std::lock_guard<std::mutex> lock(detail::pool_mutex());
+		std::unique_ptr<ThreadPool> &p = detail::global_pool();
+		if(n > 1 && (!p || p->size() != n))
+		{
+			detail::thread_count() = 1;
+			p.reset(new ThreadPool(n));
+		}
+		detail::thread_count() = n;
+	}
+
+	inline size_t getThreadCount()
+	{
+		return detail::thread_count();
+	}
+}
+
+#endif //SJTU_THREAD_POOL_HPP
@@ -0,0 +1,594 @@
+#include "matrix.hpp"
+#include "linalg.hpp"
+#include "matrix_io.hpp"
+#include "sparse_matrix.hpp"
+#include "fixed_matrix.hpp"
+#include "matrix_batch.hpp"
+#include "layout_matrix.hpp"
+#include "reductions.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using sjtu::Matrix;
+using sjtu::SparseMatrix;
+using sjtu::SparseFormat;
+
+std::pair<bool, std::string> WA(const std::string &name)
+{
+	return std::make_pair(false, "wrong answer! (" + name + ")");
+};
+
+template <class T>
+std::string toString(const T &x)
+{
+	std::stringstream ss;
+	ss << x;
+	return ss.str();
+}
+
+// largest |a(i, j) - b(i, j)|, or infinity when the shapes differ
+template <class A, class B>
+double maxDiff(const A &a, const B &b)
+{
+	if (a.rowLength() != b.rowLength() || a.columnLength() != b.columnLength())
+		return INFINITY;
+	double d = 0;
+	for (size_t i = 0; i < a.rowLength(); i++)
+		for (size_t j = 0; j < a.columnLength(); j++)
+			d = std::max(d, std::fabs((double)a(i, j) - (double)b(i, j)));
+	return d;
+}
+
+Matrix<double> randomMatrix(size_t n, size_t m)
+{
+	Matrix<double> a(n, m);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < m; j++)
+			a(i, j) = rand() % 2001 / 1000.0 - 1;
+	return a;
+}
+
+Matrix<double> identity(size_t n)
+{
+	Matrix<double> a(n, n);
+	for (size_t i = 0; i < n; i++)
+		a(i, i) = 1;
+	return a;
+}
+
+// counts how many of the calls throw std::invalid_argument
+int countInvalid(std::initializer_list<std::function<void()>> calls)
+{
+	int cnt = 0;
+	for (auto &f : calls)
+	{
+		try
+		{
+			f();
+		} catch (std::invalid_argument &) { cnt++; }
+	}
+	return cnt;
+}
+
+std::pair<bool, std::string> luTest()
+{
+	// 150 spans more than two factorization panels
+	const int N = 150, M = 7;
+	Matrix<double> a = randomMatrix(N, N), b = randomMatrix(N, M);
+	for (size_t i = 0; i < N; i++)
+		a(i, i) += N;
+	sjtu::LU<double> lu(a);
+	if (maxDiff(a * lu.solve(b), b) > 1e-9) return WA("LU solve residual");
+	if (maxDiff(a * sjtu::inverse(a), identity(N)) > 1e-9) return WA("inverse residual");
+	if (maxDiff(a * sjtu::solve(a, b), b) > 1e-9) return WA("solve residual");
+
+	// det(L U) is the product of U's diagonal, whatever pivoting does to the rows
+	Matrix<double> l(N, N), u(N, N);
+	double det = 1;
+	for (size_t i = 0; i < N; i++)
+	{
+		for (size_t j = 0; j < i; j++)
+			l(i, j) = rand() % 3 - 1, u(j, i) = rand() % 3 - 1;
+		l(i, i) = 1;
+		u(i, i) = i % 3 == 0 ? -1.5 : 1.25;
+		det *= u(i, i);
+	}
+	if (std::fabs(sjtu::determinant(l * u) / det - 1) > 1e-9) return WA("determinant");
+
+	Matrix<double> singular(3, 3, 1.0);
+	if (sjtu::determinant(singular) != 0) return WA("singular determinant");
+
+	Matrix<double> empty(0, 0);
+	if (sjtu::LU<double>(empty).determinant() != 1) return WA("empty determinant");
+	if (sjtu::LU<double>(empty).solve(empty).size() != std::make_pair(size_t(0), size_t(0)))
+		return WA("empty solve");
+	if (sjtu::LU<double>(a).solve(Matrix<double>(N, 0)).size() != std::make_pair(size_t(N), size_t(0)))
+		return WA("solve without right-hand sides");
+
+	int cnt = countInvalid({[&] { sjtu::LU<double> f(randomMatrix(3, 4)); },
+							[&] { sjtu::determinant(randomMatrix(4, 3)); },
+							[&] { sjtu::LU<double>(singular).solve(randomMatrix(3, 1)); },
+							[&] { sjtu::inverse(singular); },
+							[&] { lu.solve(randomMatrix(N + 1, 1)); }});
+	if (cnt != 5) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> choleskyTest()
+{
+	const int N = 130, M = 3;
+	Matrix<double> c = randomMatrix(N, N), b = randomMatrix(N, M);
+	Matrix<double> a = c * c.tran() + identity(N) * double(N);
+	sjtu::Cholesky<double> ch(a);
+	if (maxDiff(a * ch.solve(b), b) > 1e-9) return WA("Cholesky solve residual");
+	double det = sjtu::LU<double>(a).determinant();
+	if (std::fabs(ch.determinant() / det - 1) > 1e-9) return WA("Cholesky determinant");
+
+	Matrix<double> empty(0, 0);
+	if (sjtu::Cholesky<double>(empty).solve(empty).size() != std::make_pair(size_t(0), size_t(0)))
+		return WA("empty solve");
+
+	Matrix<double> indefinite = identity(4);
+	indefinite(2, 2) = -1;
+	int cnt = countInvalid({[&] { sjtu::Cholesky<double> f(randomMatrix(4, 5)); },
+							[&] { sjtu::Cholesky<double> f(indefinite); },
+							[&] { ch.solve(randomMatrix(N - 1, 1)); }});
+	if (cnt != 3) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> qrTest()
+{
+	const int N = 160, M = 90;
+	Matrix<double> a = randomMatrix(N, M), b = randomMatrix(N, 2);
+	sjtu::QR<double> qr(a);
+	Matrix<double> q = qr.matrixQ(), r = qr.matrixR();
+	if (maxDiff(q * r, a) > 1e-9) return WA("Q R");
+	if (maxDiff(q.tran() * q, identity(M)) > 1e-9) return WA("Q is not orthonormal");
+	for (size_t i = 0; i < M; i++)
+		for (size_t j = 0; j < i; j++)
+			if (r(i, j) != 0) return WA("R is not upper triangular");
+	// the least-squares residual is orthogonal to the columns of a
+	Matrix<double> x = qr.solve(b);
+	if (maxDiff(a.tran() * (a * x - b), Matrix<double>(M, 2)) > 1e-9) return WA("least squares");
+
+	Matrix<double> square = randomMatrix(40, 40);
+	for (size_t i = 0; i < 40; i++)
+		square(i, i) += 40;
+	Matrix<double> top(b.view().subView({ 0, 0 }, { 39, 1 }));
+	if (maxDiff(sjtu::QR<double>(square).solve(top), sjtu::solve(square, top)) > 1e-9)
+		return WA("QR and LU disagree");
+
+	if (qr.solve(Matrix<double>(N, 0)).size() != std::make_pair(size_t(M), size_t(0)))
+		return WA("solve without right-hand sides");
+	if (sjtu::QR<double>(Matrix<double>(0, 0)).matrixQ().size() != std::make_pair(size_t(0), size_t(0)))
+		return WA("empty Q");
+	if (sjtu::QR<double>(Matrix<double>(5, 0)).matrixQ().size() != std::make_pair(size_t(5), size_t(0)))
+		return WA("Q without columns");
+
+	Matrix<double> deficient(4, 2);
+	deficient(0, 0) = deficient(1, 0) = 1;
+	int cnt = countInvalid({[&] { sjtu::QR<double> f(randomMatrix(3, 4)); },
+							[&] { sjtu::QR<double>(deficient).solve(randomMatrix(4, 1)); },
+							[&] { qr.solve(randomMatrix(M, 1)); }});
+	if (cnt != 3) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+// overwrites count bytes at offset in the file at path
+void patchFile(const std::string &path, size_t offset, const void *bytes, size_t count)
+{
+	std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+	f.seekp(offset);
+	f.write((const char *)bytes, count);
+}
+
+std::pair<bool, std::string> ioTest()
+{
+	const std::string path = "NumericTest.tmp";
+	const int N = 37, M = 53;
+	Matrix<double> a = randomMatrix(N, M);
+	sjtu::save(a, path);
+	if (maxDiff(sjtu::load<double>(path), a) != 0) return WA("save / load");
+	{
+		sjtu::MappedMatrix<double> mapped = Matrix<double>::mapFile(path);
+		if (maxDiff(mapped, a) != 0) return WA("mapFile");
+		sjtu::MappedMatrix<double> cow = Matrix<double>::mapFile(path, sjtu::MapMode::CopyOnWrite);
+		cow.writableView()(0, 0) = 42;
+		if (cow(0, 0) != 42 || mapped(0, 0) != a(0, 0)) return WA("copy on write");
+	}
+	if (maxDiff(sjtu::load<double>(path), a) != 0) return WA("copy on write changed the file");
+
+	// a view with a stride saves only its own elements
+	sjtu::save(a.view().subView({ 3, 5 }, { 10, 20 }), path);
+	if (maxDiff(sjtu::load<double>(path), a.view().subView({ 3, 5 }, { 10, 20 })) != 0) return WA("save a view");
+
+	Matrix<int> ints(4, 6, 7);
+	ints(3, 5) = -1;
+	sjtu::save(ints, path);
+	if (maxDiff(sjtu::load<int>(path), ints) != 0) return WA("save / load int");
+	sjtu::save(Matrix<int>(0, 3), path);
+	if (sjtu::load<int>(path).size() != std::make_pair(size_t(0), size_t(3))) return WA("empty file");
+
+	int cnt = 0;
+	auto rejected = [&](const std::function<void()> &f) {
+		try
+		{
+			f();
+		} catch (std::runtime_error &) { cnt++; }
+	};
+	sjtu::save(ints, path);
+	if (countInvalid({[&] { Matrix<int>::mapFile(path).writableView(); }}) != 1) return WA("writing a read-only mapping");
+	rejected([&] { sjtu::load<float>(path); });
+	rejected([&] { sjtu::load<unsigned>(path); });
+	rejected([&] { sjtu::MappedMatrix<double> m(path); });
+	uint64_t rows = 1000;
+	patchFile(path, offsetof(sjtu::detail::matrix_file_header, rows), &rows, sizeof rows);
+	rejected([&] { sjtu::load<int>(path); });
+	rejected([&] { Matrix<int>::mapFile(path); });
+	sjtu::save(ints, path);
+	patchFile(path, 0, "NOTAMAT", 8);
+	rejected([&] { sjtu::load<int>(path); });
+	std::remove(path.c_str());
+	rejected([&] { sjtu::load<int>(path); });
+	rejected([&] { Matrix<int>::mapFile(path); });
+	if (cnt != 8) return WA("Rejected " + toString(cnt) + " bad files");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> sparseTest()
+{
+	const int N = 60, K = 45, M = 70;
+	Matrix<double> a(N, K), b(K, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < K; j++)
+			if (rand() % 8 == 0) a(i, j) = rand() % 9 - 4;
+	for (size_t i = 0; i < K; i++)
+		for (size_t j = 0; j < M; j++)
+			if (rand() % 8 == 0) b(i, j) = rand() % 9 - 4;
+	Matrix<double> ab = a * b;
+	std::vector<double> v(K);
+	for (size_t j = 0; j < K; j++)
+		v[j] = rand() % 5;
+
+	for (SparseFormat fa : { SparseFormat::CSR, SparseFormat::CSC })
+	{
+		SparseMatrix<double> sa(a, fa);
+		if (maxDiff(sa, a) != 0 || maxDiff(sa.toDense(), a) != 0) return WA("dense to sparse");
+		if (maxDiff(sa.tran(), a.tran()) != 0) return WA("sparse transpose");
+		if (!(sa.toFormat(SparseFormat::CSR) == sa.toFormat(SparseFormat::CSC))) return WA("toFormat");
+		if (maxDiff(sa * b, ab) > 1e-12) return WA("sparse * dense");
+		if (maxDiff(a * SparseMatrix<double>(b, fa), ab) > 1e-12) return WA("dense * sparse");
+		std::vector<double> y = sa * v;
+		for (size_t i = 0; i < N; i++)
+		{
+			double s = 0;
+			for (size_t j = 0; j < K; j++)
+				s += a(i, j) * v[j];
+			if (std::fabs(y[i] - s) > 1e-12) return WA("sparse * vector");
+		}
+		for (SparseFormat fb : { SparseFormat::CSR, SparseFormat::CSC })
+		{
+			SparseMatrix<double> c = sa * SparseMatrix<double>(b, fb);
+			if (c.format() != SparseFormat::CSR || maxDiff(c, ab) > 1e-12) return WA("sparse * sparse");
+			if (c.nonZeros() != SparseMatrix<double>(ab).nonZeros()) return WA("sparse * sparse stored zeros");
+			SparseMatrix<double> sum = sa + SparseMatrix<double>(a * 2.0, fb), diff = sa - sa;
+			if (maxDiff(sum, a * 3.0) != 0 || diff.nonZeros() != 0) return WA("sparse + / -");
+		}
+	}
+
+	// duplicates are summed and cancelling entries are not stored
+	SparseMatrix<int> t(3, 4, {{ 0, 1, 2 }, { 2, 3, 5 }, { 0, 1, 3 }, { 1, 0, 4 }, { 1, 0, -4 }});
+	if (t.nonZeros() != 2 || t(0, 1) != 5 || t(2, 3) != 5 || t(1, 0) != 0) return WA("triplets");
+
+	// values that convert or scale to zero are dropped, not stored
+	SparseMatrix<double> quarters(2, 3, {{ 0, 1, 0.25 }, { 1, 2, 0.25 }, { 1, 0, 2.5 }});
+	SparseMatrix<int> truncated(quarters);
+	if (truncated.nonZeros() != 1 || truncated(1, 0) != 2) return WA("conversion keeps zeros");
+	SparseMatrix<double> tiny(quarters);
+	tiny *= 1e-320;
+	tiny *= 1e-10;
+	if (tiny.nonZeros() != 0 || !(tiny == SparseMatrix<double>(2, 3))) return WA("scaling keeps zeros");
+	SparseMatrix<int> scaled(2, 2, {{ 0, 0, 2 }, { 1, 1, 5 }});
+	scaled *= 0.4;
+	if (scaled.nonZeros() != 1 || scaled(1, 1) != 2) return WA("scaling an int matrix");
+
+	SparseMatrix<double> empty(0, 5);
+	if ((empty * SparseMatrix<double>(5, 0)).size() != std::make_pair(size_t(0), size_t(0))) return WA("empty product");
+
+	SparseMatrix<double> sa(a);
+	int cnt = countInvalid({[&] { sa * sa; },
+							[&] { sa * a; },
+							[&] { a * sa; },
+							[&] { sa + SparseMatrix<double>(b); },
+							[&] { sa * std::vector<double>(K + 1); },
+							[&] { sa(N, 0); },
+							[&] { SparseMatrix<int>(2, 2, {{ 2, 0, 1 }}); }});
+	if (cnt != 7) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> fixedTest()
+{
+	sjtu::FixedMatrix<double, 4, 3> a(randomMatrix(4, 3));
+	sjtu::FixedMatrix<double, 3, 5> b(randomMatrix(3, 5));
+	Matrix<double> da(a), db(b);
+	if (maxDiff(da, a) != 0) return WA("Matrix from FixedMatrix");
+	if (maxDiff(a * b, da * db) > 1e-12) return WA("4x3 * 3x5 product");
+	if (maxDiff(a.tran(), da.tran()) != 0) return WA("transpose");
+	if (maxDiff(b.tran() * a.tran(), (da * db).tran()) > 1e-12) return WA("product of transposes");
+	if (maxDiff(a + a * 2.0 - a, da * 2.0) > 1e-15) return WA("elementwise");
+
+	sjtu::FixedMatrix<double, 4, 4> m(randomMatrix(4, 4));
+	Matrix<double> dm(m);
+	if (maxDiff(m * m * m, dm * dm * dm) > 1e-12) return WA("4x4 powers");
+	sjtu::FixedMatrix<double, 1, 4> r(randomMatrix(1, 4));
+	sjtu::FixedMatrix<double, 1, 1> s = r * m.tran() * sjtu::FixedMatrix<double, 4, 1>(1.0);
+	if (maxDiff(s, Matrix<double>(r) * dm.tran() * Matrix<double>(4, 1, 1.0)) > 1e-12) return WA("1x1 product");
+
+	// mixed element types widen like Matrix does
+	sjtu::FixedMatrix<int, 2, 3> i = {{ 1, -2, 3 },
+									  { 4, 5, -6 }};
+	sjtu::FixedMatrix<double, 3, 2> d = {{ 0.5, 1 },
+										 { 1.5, 2 },
+										 { 2.5, 3 }};
+	auto p = i * d;
+	static_assert(std::is_same<decltype(p), sjtu::FixedMatrix<double, 2, 2>>::value, "int * double gives double");
+	if (maxDiff(p, Matrix<int>(i) * Matrix<double>(d)) != 0) return WA("mixed product");
+	if (!(i.tran().tran() == i) || i.tran()(2, 1) != -6) return WA("int transpose");
+
+	Matrix<double> wrong(3, 4);
+	int cnt = countInvalid({[&] { sjtu::FixedMatrix<double, 4, 3> f(wrong); },
+							[&] { sjtu::FixedMatrix<int, 2, 2>({{ 1, 2 }, { 3 }}); },
+							[&] { a.at(4, 0); }});
+	if (cnt != 3) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> multiplyAsTest()
+{
+	// extreme int8 values: single products reach 2^14 and the sums leave the int16 range
+	const int N = 70, K = 300, M = 90;
+	Matrix<int8_t> a(N, K), b(K, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < K; j++)
+			a(i, j) = rand() % 4 == 0 ? rand() % 256 - 128 : (i + j) % 2 ? 127 : -128;
+	for (size_t i = 0; i < K; i++)
+		for (size_t j = 0; j < M; j++)
+			b(i, j) = rand() % 4 == 0 ? rand() % 256 - 128 : i % 2 ? 127 : -128;
+	Matrix<long long> exact(N, M);
+	for (size_t i = 0; i < N; i++)
+		for (size_t k = 0; k < K; k++)
+			for (size_t j = 0; j < M; j++)
+				exact(i, j) += a(i, k) * b(k, j);
+	bool wide = false;
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < M; j++)
+			wide |= exact(i, j) > 32767 || exact(i, j) < -32768;
+	if (!wide) return WA("the int8 inputs do not leave the int16 range");
+
+	Matrix<int> c = sjtu::multiplyAs<int>(a, b);
+	if (maxDiff(c, exact) != 0) return WA("multiplyAs<int> on int8");
+	if (maxDiff(sjtu::multiplyAs<int>(a, Matrix<int>(b)), exact) != 0) return WA("multiplyAs<int> on int8 and int");
+	if (maxDiff(sjtu::multiplyAs<long long>(Matrix<int8_t>(a.view().subView({ 0, 0 }, { 0, K - 1 })), b),
+				Matrix<long long>(exact.view().subView({ 0, 0 }, { 0, M - 1 }))) != 0)
+		return WA("multiplyAs<long long> on a single row");
+
+	// float inputs accumulated in double match a double reference to double precision
+	const int P = 120, Q = 257, R = 65;
+	Matrix<float> f(P, Q), g(Q, R);
+	for (size_t i = 0; i < P; i++)
+		for (size_t j = 0; j < Q; j++)
+			f(i, j) = (rand() % 2001 / 1000.0f - 1) / 3;
+	for (size_t i = 0; i < Q; i++)
+		for (size_t j = 0; j < R; j++)
+			g(i, j) = (rand() % 2001 / 1000.0f - 1) / 7;
+	Matrix<double> ref = Matrix<double>(f) * Matrix<double>(g);
+	Matrix<double> h = sjtu::multiplyAs<double>(f, g);
+	if (maxDiff(h, ref) > 1e-12) return WA("multiplyAs<double> on float");
+	if (maxDiff(sjtu::multiplyAs<double>(f, g, sjtu::MultiplyAlgorithm::Blocked), ref) > 1e-12)
+		return WA("multiplyAs<double> blocked");
+	if (maxDiff(f * g, ref) < 1e-9) return WA("a float product should round");
+
+	int cnt = countInvalid({[&] { sjtu::multiplyAs<int>(a, a); },
+							[&] { sjtu::multiplyAs<double>(g, f); }});
+	if (cnt != 2) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> batchTest()
+{
+	// more lanes than one kernel block, and not a multiple of it
+	const size_t B = 601, N = 3, K = 4, M = 5;
+	std::vector<Matrix<double>> as, bs;
+	for (size_t b = 0; b < B; b++)
+		as.push_back(randomMatrix(N, K)), bs.push_back(randomMatrix(K, M));
+	sjtu::MatrixBatch<double> a(as), b(bs);
+	if (a.count() != B || a.size() != std::make_pair(N, K)) return WA("batch shape");
+	for (size_t t = 0; t < B; t += 37)
+		if (maxDiff(a.matrix(t), as[t]) != 0 || a(t, 2, 3) != as[t](2, 3)) return WA("batch layout");
+
+	sjtu::MatrixBatch<double> c = a * b;
+	if (c.count() != B || c.size() != std::make_pair(N, M)) return WA("product shape");
+	for (size_t t = 0; t < B; t++)
+		if (maxDiff(c.matrix(t), as[t] * bs[t]) > 1e-12) return WA("batched product " + toString(t));
+
+	sjtu::MatrixBatch<double> d = (a + a * 3.0 - a).tran();
+	for (size_t t = 0; t < B; t++)
+		if (maxDiff(d.matrix(t), (as[t] * 3.0).tran()) > 1e-15) return WA("batched elementwise / tran " + toString(t));
+
+	// integer lanes go through the plain kernel
+	sjtu::MatrixBatch<int> e(300, 2, 2), f(300, 2, 2, 1);
+	for (size_t t = 0; t < 300; t++)
+		e.setMatrix(t, Matrix<int>({{ (int)t, 1 }, { 2, -(int)t }}));
+	sjtu::MatrixBatch<int> g = multiply(e, e) - f * 2;
+	for (size_t t = 0; t < 300; t++)
+		if (g.matrix(t) != Matrix<int>({{ (int)(t * t), -2 }, { -2, (int)(t * t) }}))
+			return WA("int batch " + toString(t));
+
+	if (sjtu::MatrixBatch<double>(std::vector<Matrix<double>>()).count() != 0) return WA("empty batch");
+
+	int cnt = countInvalid({[&] { a * a; },
+							[&] { a * sjtu::MatrixBatch<double>(B - 1, K, M); },
+							[&] { a + b; },
+							[&] { a.matrix(B); },
+							[&] { a.setMatrix(0, bs[0]); },
+							[&] { sjtu::MatrixBatch<double> h(std::vector<Matrix<double>>{ as[0], bs[0] }); }});
+	if (cnt != 6) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> layoutTest()
+{
+	using sjtu::Layout;
+	using sjtu::LayoutMatrix;
+	// sizes off the tile boundary so the edge tiles carry padding
+	const int N = 70, K = 45, M = 83;
+	Matrix<double> a = randomMatrix(N, K), b = randomMatrix(K, M), ab = a * b;
+	LayoutMatrix<double, Layout::RowMajor> ra(a);
+	LayoutMatrix<double, Layout::ColMajor> ca(a), cb(b);
+	LayoutMatrix<double, Layout::Tiled> ta(a), tb(b);
+	if (maxDiff(ca, a) != 0 || maxDiff(ta, a) != 0 || maxDiff(Matrix<double>(ta), a) != 0) return WA("conversion from Matrix");
+	if (maxDiff(LayoutMatrix<double, Layout::Tiled>(ca), a) != 0 || maxDiff(LayoutMatrix<double, Layout::ColMajor>(ta), a) != 0)
+		return WA("conversion between layouts");
+	for (size_t i = 0; i < N; i++)
+		for (size_t j = 0; j < K; j++)
+			if (ca.data()[i * ca.rowStride() + j * ca.colStride()] != a(i, j)) return WA("column-major strides");
+	if (maxDiff(ta.row(N - 1), a.row(N - 1)) != 0 || maxDiff(ca.column(K - 1), a.column(K - 1)) != 0) return WA("row / column");
+
+	LayoutMatrix<double, Layout::Tiled> tt = ta * tb;
+	LayoutMatrix<double, Layout::ColMajor> cc = ca * cb;
+	if (maxDiff(tt, ab) > 1e-12) return WA("Tiled * Tiled");
+	if (maxDiff(cc, ab) > 1e-12) return WA("ColMajor * ColMajor");
+	if (maxDiff(ta * cb, ab) > 1e-12 || maxDiff(ca * tb, ab) > 1e-12 || maxDiff(ra * tb, ab) > 1e-12) return WA("mixed layouts");
+	if (maxDiff(a * tb, ab) > 1e-12 || maxDiff(ca * b, ab) > 1e-12) return WA("Matrix and LayoutMatrix");
+
+	if (maxDiff(ta.tran(), a.tran()) != 0 || maxDiff(ca.tran(), a.tran()) != 0 || maxDiff(ra.tran(), a.tran()) != 0)
+		return WA("tran");
+	if (maxDiff(tb.tran() * ta.tran(), ab.tran()) > 1e-12) return WA("product of tiled transposes");
+	if (!(ta.tran().tran() == ta) || ta + ta - ta != ta) return WA("tiled == / + / -");
+
+	LayoutMatrix<int, Layout::Tiled> small(1, 1, 5);
+	if (small(0, 0) != 5 || maxDiff(small * small, Matrix<int>(1, 1, 25)) != 0) return WA("1x1 tiled");
+
+	int cnt = countInvalid({[&] { ta * ta; },
+							[&] { ca * a; },
+							[&] { ta + tb; },
+							[&] { ta.at(N, 0); },
+							[&] { ca.column(K); }});
+	if (cnt != 5) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+std::pair<bool, std::string> reductionTest()
+{
+	// several reduction chunks, plus tall matrices whose short rows are grouped
+	const size_t shapes[][2] = {{ 300, 700 }, { 40000, 3 }, { 7, 1 }};
+	for (auto &&s : shapes)
+	{
+		const size_t N = s[0], M = s[1];
+		Matrix<double> a = randomMatrix(N, M);
+		a(N / 2, M / 2) = -5, a(N - 1, M - 1) = -5, a(0, M - 1) = 5;
+		Matrix<double> rows(N, 1), cols(1, M);
+		double total = 0;
+		for (size_t i = 0; i < N; i++)
+			for (size_t j = 0; j < M; j++)
+				rows(i, 0) += a(i, j), cols(0, j) += a(i, j), total += a(i, j);
+		std::string shape = toString(N) + "x" + toString(M);
+		if (std::fabs(sjtu::sum(a) - total) > 1e-9) return WA("sum " + shape);
+		if (maxDiff(sjtu::rowSums(a), rows) > 1e-12) return WA("rowSums " + shape);
+		if (maxDiff(sjtu::colSums(a), cols) > 1e-9) return WA("colSums " + shape);
+		if (sjtu::min(a) != -5 || sjtu::max(a) != 5) return WA("min / max " + shape);
+		if (sjtu::argmin(a) != std::make_pair(N / 2, M / 2) || sjtu::argmax(a) != std::make_pair(size_t(0), M - 1))
+			return WA("argmin / argmax picks the first " + shape);
+		if (std::fabs(sjtu::dot(a, a) - sjtu::norm(a) * sjtu::norm(a)) > 1e-9) return WA("dot / norm " + shape);
+
+		// a strided one-column view
+		sjtu::ConstMatrixView<double> c = a.columnView(M - 1);
+		Matrix<double> dc(c);
+		if (std::fabs(sjtu::sum(c) - sjtu::sum(dc)) > 1e-12 || sjtu::min(c) != -5 || sjtu::argmax(c) != std::make_pair(size_t(0), size_t(0)))
+			return WA("column view " + shape);
+		if (maxDiff(sjtu::colSums(c), sjtu::colSums(dc)) > 1e-12 || maxDiff(sjtu::rowSums(c), dc) != 0) return WA("column view sums " + shape);
+
+		// the partials and the order they are merged in do not depend on the thread count
+		size_t threads = sjtu::getThreadCount();
+		sjtu::setThreadCount(4);
+		double parallel = sjtu::sum(a), parallelDot = sjtu::dot(a, a);
+		sjtu::setThreadCount(1);
+		double serial = sjtu::sum(a), serialDot = sjtu::dot(a, a);
+		sjtu::setThreadCount(threads);
+		if (parallel != serial || parallelDot != serialDot) return WA("result depends on the thread count " + shape);
+	}
+
+	Matrix<int> ints(3, 4);
+	for (size_t i = 0; i < 3; i++)
+		for (size_t j = 0; j < 4; j++)
+			ints(i, j) = i * 4 + j - 5;
+	if (sjtu::sum(ints) != 6 || sjtu::min(ints) != -5 || sjtu::max(ints) != 6) return WA("int reductions");
+	if (sjtu::rowSums(ints) != Matrix<int>({{ -14 }, { 2 }, { 18 }}) || sjtu::colSums(ints) != Matrix<int>({{ -3, 0, 3, 6 }}))
+		return WA("int row / column sums");
+
+	// empty matrices: sums are zero-sized or zero, extremes do not exist
+	Matrix<double> empty(0, 5);
+	if (sjtu::sum(empty) != 0 || sjtu::dot(empty, empty) != 0 || sjtu::norm(empty) != 0) return WA("empty sum");
+	if (sjtu::rowSums(empty).size() != std::make_pair(size_t(0), size_t(1))) return WA("empty rowSums");
+	if (maxDiff(sjtu::colSums(empty), Matrix<double>(1, 5)) != 0) return WA("empty colSums");
+	if (sjtu::colSums(Matrix<double>(4, 0)).size() != std::make_pair(size_t(1), size_t(0))) return WA("colSums without columns");
+
+	int cnt = countInvalid({[&] { sjtu::min(empty); },
+							[&] { sjtu::max(empty); },
+							[&] { sjtu::argmin(empty); },
+							[&] { sjtu::argmax(Matrix<int>(3, 0)); },
+							[&] { sjtu::dot(ints, Matrix<int>(4, 3)); }});
+	if (cnt != 5) return WA("Caught " + toString(cnt) + " exceptions");
+	return { true, "Congratulation" };
+}
+
+int main()
+{
+
+	std::pair<std::string, std::function<std::pair<bool, std::string>(void)>> testcases[] = {{ "luTest",       luTest },
+																							 { "choleskyTest", choleskyTest },
+																							 { "qrTest",       qrTest },
+																							 { "ioTest",       ioTest },
+																							 { "sparseTest",   sparseTest },
+																							 { "fixedTest",    fixedTest },
+																							 { "multiplyAsTest", multiplyAsTest },
+																							 { "batchTest",      batchTest },
+																							 { "layoutTest",     layoutTest },
+																							 { "reductionTest",  reductionTest }};
+
+	bool result;
+	std::string information;
+	for (auto &&testcase : testcases)
+	{
+		std::cout << testcase.first << ": ";
+		try
+		{
+			std::tie(result, information) = testcase.second();
+		} catch (std::exception &e)
+		{
+			result = false;
+			information = std::string("Runtime Error! (") + e.what() + ")";
+		}
+		if (result)
+		{
+			std::cout << "PASS. " << information << std::endl;
+		} else
+		{
+			std::cout << "FAIL. " << information << std::endl;
+		}
+	}
+	return 0;
+}
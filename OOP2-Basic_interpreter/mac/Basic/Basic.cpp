@@ -9,6 +9,7 @@
  */
 
 #include <cctype>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include "exp.h"
@@ -25,6 +26,13 @@ using namespace std;
 
 void processLine(const string &line, Program & program, EvalState & state);
 
+/*
+ * Setting BASIC_TREE_WALK in the environment makes RUN execute the parsed
+ * statements directly instead of compiling them, for debugging.
+ */
+
+static const bool treeWalk = getenv("BASIC_TREE_WALK") != nullptr;
+
 /* Main program */
 
 int main()
@@ -51,18 +59,19 @@ void showHelp()
 void processCode(const int &lineNum, const string &line, Program &program, TokenScanner &scanner)
 {
     if(scanner.hasMoreTokens()) {
-        program.addSourceLine(lineNum, line);
         string token = scanner.nextToken();
+        Arena nodes;
         Statement *st = nullptr;
-        if(token == "REM")  st = new Comment(scanner);
-        else if(token ==  "LET")    st = new Assignment(scanner);
-        else if(token ==  "PRINT")  st = new Print(scanner);
-        else if(token ==  "INPUT")  st = new Input(scanner);
-        else if(token ==  "END")    st = new End(scanner);
-        else if(token ==  "GOTO")    st = new Transfer(scanner);
-        else if(token ==  "IF") st = new Condition(scanner);
+        if(token == "REM")  st = new (nodes) Comment(scanner);
+        else if(token ==  "LET")    st = new (nodes) Assignment(scanner, nodes);
+        else if(token ==  "PRINT")  st = new (nodes) Print(scanner, nodes);
+        else if(token ==  "INPUT")  st = new (nodes) Input(scanner);
+        else if(token ==  "END")    st = new (nodes) End(scanner);
+        else if(token ==  "GOTO")    st = new (nodes) Transfer(scanner);
+        else if(token ==  "IF") st = new (nodes) Condition(scanner, nodes);
         else    error("SYNTAX ERROR");
-        program.setParsedStatement(lineNum, st);
+        program.addSourceLine(lineNum, line);
+        program.setParsedStatement(lineNum, st, std::move(nodes));
     }
     else {
         program.removeSourceLine(lineNum);
@@ -74,7 +83,10 @@ void processCom(const string &token, const string &line, Program &program, EvalS
     if(token == "RUN") {
         if(scanner.hasMoreTokens())
             error("SYNTAX ERROR");
-        program.run(state);
+        if(treeWalk)
+            program.interpret(state);
+        else
+            program.run(state);
     } else if(token == "LIST") {
         if(scanner.hasMoreTokens())
             error("SYNTAX ERROR");
@@ -95,7 +107,8 @@ void processCom(const string &token, const string &line, Program &program, EvalS
         exit(0);
     } else if(token == "LET") {
         try {
-            Statement *st = new Assignment(scanner);
+            Arena nodes;
+            Statement *st = new (nodes) Assignment(scanner, nodes);
             st->execute(state);
         }
         catch(ErrorException &ex) {
@@ -103,7 +116,8 @@ void processCom(const string &token, const string &line, Program &program, EvalS
         }
     } else if(token == "INPUT") {
         try {
-            Statement *st = new Input(scanner);
+            Arena nodes;
+            Statement *st = new (nodes) Input(scanner);
             st->execute(state);
         }
         catch(ErrorException &ex) {
@@ -111,7 +125,8 @@ void processCom(const string &token, const string &line, Program &program, EvalS
         }
     } else if(token == "PRINT") {
         try {
-            Statement *st = new Print(scanner);
+            Arena nodes;
+            Statement *st = new (nodes) Print(scanner, nodes);
             st->execute(state);
         }
         catch(ErrorException &ex) {
@@ -0,0 +1,78 @@
+/*
+ * File: arena.cpp
+ * ---------------
+ * This file implements the Arena class.
+ */
+
+#include <cstdlib>
+#include <new>
+#include "arena.h"
+using namespace std;
+
+/*
+ * Implementation notes: blocks
+ * ----------------------------
+ * A block is a header followed by its storage.  The first block is
+ * small, since most lines hold a handful of nodes, and each further
+ * block doubles the size of the last so that a long line needs only a
+ * few of them.
+ */
+
+static const size_t ALIGN = alignof(max_align_t);
+static const size_t FIRST_BLOCK = 256;
+
+static size_t roundUp(size_t n) {
+    return (n + ALIGN - 1) & ~(ALIGN - 1);
+}
+
+Arena::Arena(): head(nullptr), top(nullptr), end(nullptr) {}
+
+Arena::Arena(Arena &&other) noexcept: head(other.head), top(other.top), end(other.end) {
+    other.head = nullptr;
+    other.top = other.end = nullptr;
+}
+
+Arena &Arena::operator=(Arena &&other) noexcept {
+    if (this != &other) {
+        clear();
+        head = other.head;
+        top = other.top;
+        end = other.end;
+        other.head = nullptr;
+        other.top = other.end = nullptr;
+    }
+    return *this;
+}
+
+Arena::~Arena() {
+    clear();
+}
+
+void *Arena::allocate(size_t size) {
+    size = roundUp(size);
+    if (size > (size_t) (end - top)) {
+        size_t capacity = head ? head->size * 2 : FIRST_BLOCK;
+        if (capacity < size)
+            capacity = size;
+        Block *block = (Block *) malloc(roundUp(sizeof(Block)) + capacity);
+        if (!block)
+            throw bad_alloc();
+        block->next = head;
+        block->size = capacity;
+        head = block;
+        top = (char *) block + roundUp(sizeof(Block));
+        end = top + capacity;
+    }
+    void *p = top;
+    top += size;
+    return p;
+}
+
+void Arena::clear() {
+    while (head) {
+        Block *next = head->next;
+        free(head);
+        head = next;
+    }
+    top = end = nullptr;
+}
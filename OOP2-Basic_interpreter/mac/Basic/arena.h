@@ -0,0 +1,68 @@
+/*
+ * File: arena.h
+ * -------------
+ * This interface exports the Arena class, a bump allocator that owns
+ * the expression and statement nodes parsed from one program line.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <cstddef>
+
+/*
+ * Class: Arena
+ * ------------
+ * Memory is handed out from the end of the current block, so the nodes
+ * of a line lie next to each other in the order the parser built them.
+ * Nothing is freed individually: destroying or clearing the arena
+ * releases everything at once, without visiting the nodes.  Objects
+ * placed in an arena must therefore own no other memory.
+ *
+ * An arena can be moved but not copied, and moving it does not move
+ * the blocks, so pointers into it stay valid.
+ */
+
+class Arena {
+
+public:
+
+    Arena();
+    Arena(Arena &&other) noexcept;
+    Arena &operator=(Arena &&other) noexcept;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena();
+
+/*
+ * Method: allocate
+ * Usage: void *p = arena.allocate(size);
+ * --------------------------------------
+ * Returns size bytes aligned for any type, valid until the arena is
+ * cleared or destroyed.
+ */
+
+    void *allocate(std::size_t size);
+
+/*
+ * Method: clear
+ * Usage: arena.clear();
+ * ---------------------
+ * Releases every allocation at once.
+ */
+
+    void clear();
+
+private:
+
+    struct Block {
+        Block *next;
+        std::size_t size;
+    };
+
+    Block *head;
+    char *top, *end;
+
+};
+
+#endif
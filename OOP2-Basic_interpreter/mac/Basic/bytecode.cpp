@@ -0,0 +1,209 @@
+/*
+ * File: bytecode.cpp
+ * ------------------
+ * This file implements the compiler and the virtual machine declared
+ * in bytecode.h.
+ */
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include "bytecode.h"
+#include "statement.h"
+
+#include "../StanfordCPPLib/error.h"
+using namespace std;
+
+/* Implementation of the Compiler class */
+
+Compiler::Compiler(Bytecode &out, const unordered_map<int, int> &lineIndex):
+        out(out), lineIndex(lineIndex), lineStart(lineIndex.size()) {
+    out = Bytecode();
+}
+
+void Compiler::beginLine(int index) {
+    lineStart[index] = (int) out.code.size();
+}
+
+void Compiler::emit(Opcode op, int a, int b, int c) {
+    Instruction ins;
+    ins.op = op;
+    ins.a = a;
+    ins.b = b;
+    ins.c = c;
+    out.code.push_back(ins);
+}
+
+void Compiler::emitJump(Opcode op, int lineNumber, int a, int b) {
+    auto it = lineIndex.find(lineNumber);
+    fixups.push_back(make_pair((int) out.code.size(), it == lineIndex.end() ? -1 : it->second));
+    emit(op, a, b, -1);
+}
+
+void Compiler::emitFail(const string &msg) {
+    out.messages.push_back(msg);
+    emit(FAIL, (int) out.messages.size() - 1);
+}
+
+void Compiler::emitExec(Statement *stmt) {
+    out.statements.push_back(stmt);
+    emit(EXEC, (int) out.statements.size() - 1);
+}
+
+/*
+ * Implementation notes: finish
+ * ----------------------------
+ * All jumps to missing lines share one FAIL placed after the final HALT,
+ * where falling off the end of the program can never reach it.
+ */
+
+void Compiler::finish() {
+    emit(HALT);
+    int missing = -1;
+    for (auto &fix : fixups) {
+        if (fix.second >= 0) {
+            out.code[fix.first].c = lineStart[fix.second];
+            continue;
+        }
+        if (missing < 0) {
+            missing = (int) out.code.size();
+            emitFail("LINE NUMBER ERROR");
+        }
+        out.code[fix.first].c = missing;
+    }
+}
+
+void Compiler::useRegister(int reg) {
+    if (reg >= out.registers)
+        out.registers = reg + 1;
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * The left operand goes into reg and the right one into reg + 1, so the
+ * registers in use at any point form a stack as deep as the expression.
+ * Compound expressions are lowered according to the form the CompoundExp
+ * constructor chose, so folded and simplified subtrees cost no more here
+ * than they do in eval.  Anything eval would reject at run time becomes
+ * a FAIL at the same point in the evaluation order.
+ */
+
+void Compiler::compileExp(Expression *exp, int reg) {
+    useRegister(reg);
+    switch (exp->getType()) {
+    case CONSTANT:
+        emit(LOAD_CONST, reg, ((ConstantExp *) exp)->getValue());
+        return;
+    case IDENTIFIER:
+        emit(LOAD_VAR, reg, ((IdentifierExp *) exp)->getSlot());
+        return;
+    case COMPOUND:
+        break;
+    }
+    CompoundExp *cmp = (CompoundExp *) exp;
+    switch (cmp->getForm()) {
+    case CompoundExp::FOLDED:
+        emit(LOAD_CONST, reg, cmp->getValue());
+        return;
+    case CompoundExp::FORWARD:
+        compileExp(cmp->getOperand(), reg);
+        return;
+    case CompoundExp::SHIFT:
+        compileExp(cmp->getOperand(), reg);
+        emit(SHL, reg, reg, cmp->getValue());
+        return;
+    case CompoundExp::DIVIDE_SHIFT:
+        compileExp(cmp->getOperand(), reg);
+        emit(DIV_SHIFT, reg, reg, cmp->getValue());
+        return;
+    case CompoundExp::ASSIGN_VAR:
+        compileExp(cmp->getRHS(), reg);
+        emit(STORE_VAR, cmp->getValue(), reg);
+        return;
+    case CompoundExp::BAD_ASSIGN:
+        emitFail("Illegal variable in assignment");
+        return;
+    default:
+        break;
+    }
+    static const Opcode arithmetic[] = { HALT, ADD, SUB, MUL, DIV };
+    compileExp(cmp->getLHS(), reg);
+    compileExp(cmp->getRHS(), reg + 1);
+    emit(arithmetic[cmp->getOperator()], reg, reg, reg + 1);
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * A single switch inside a loop; the only state besides the registers
+ * is the program counter.  Variables live in the EvalState, addressed
+ * by slot, so values assigned by the program remain visible after it
+ * stops.
+ */
+
+void execute(const Bytecode &code, EvalState &state) {
+    vector<int> regs(code.registers > 0 ? code.registers : 1);
+    int *r = regs.data();
+    const Instruction *prog = code.code.data();
+    int pc = 0;
+    while (true) {
+        const Instruction &ins = prog[pc++];
+        switch (ins.op) {
+        case LOAD_CONST:
+            r[ins.a] = ins.b;
+            break;
+        case LOAD_VAR:
+            if (!state.isDefined(ins.b))
+                error("VARIABLE NOT DEFINED");
+            r[ins.a] = state.getValue(ins.b);
+            break;
+        case STORE_VAR:
+            state.setValue(ins.a, r[ins.b]);
+            break;
+        case ADD:
+            r[ins.a] = r[ins.b] + r[ins.c];
+            break;
+        case SUB:
+            r[ins.a] = r[ins.b] - r[ins.c];
+            break;
+        case MUL:
+            r[ins.a] = r[ins.b] * r[ins.c];
+            break;
+        case DIV:
+            if (r[ins.c] == 0)
+                error("DIVIDE BY ZERO");
+            r[ins.a] = r[ins.b] / r[ins.c];
+            break;
+        case SHL:
+            r[ins.a] = (int) ((unsigned) r[ins.b] << ins.c);
+            break;
+        case DIV_SHIFT:
+            r[ins.a] = (r[ins.b] + ((r[ins.b] >> 31) & ((1 << ins.c) - 1))) >> ins.c;
+            break;
+        case PRINT:
+            cout << r[ins.a] << endl;
+            break;
+        case EXEC:
+            code.statements[ins.a]->execute(state);
+            break;
+        case JUMP:
+            pc = ins.c;
+            break;
+        case JUMP_LT:
+            if (r[ins.a] < r[ins.b]) pc = ins.c;
+            break;
+        case JUMP_GT:
+            if (r[ins.a] > r[ins.b]) pc = ins.c;
+            break;
+        case JUMP_EQ:
+            if (r[ins.a] == r[ins.b]) pc = ins.c;
+            break;
+        case FAIL:
+            error(code.messages[ins.a]);
+            break;
+        case HALT:
+            return;
+        }
+    }
+}
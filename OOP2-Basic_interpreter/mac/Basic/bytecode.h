@@ -0,0 +1,150 @@
+/*
+ * File: bytecode.h
+ * ----------------
+ * This interface exports the compiled form of a BASIC program: a flat
+ * array of register instructions in which every GOTO and IF target has
+ * already been resolved to an instruction index, together with the
+ * Compiler that produces it and the dispatch loop that runs it.
+ */
+
+#ifndef _bytecode_h
+#define _bytecode_h
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "evalstate.h"
+#include "exp.h"
+
+class Statement;
+
+/*
+ * Type: Opcode
+ * ------------
+ * The instruction set.  Registers are numbered from 0 and hold the
+ * temporaries of the expression being evaluated; a, b and c name the
+ * operands in the order they are listed.
+ */
+
+enum Opcode {
+    LOAD_CONST,     /* r[a] = b                                    */
+    LOAD_VAR,       /* r[a] = variable in slot b                   */
+    STORE_VAR,      /* variable in slot a = r[b]                   */
+    ADD,            /* r[a] = r[b] + r[c]                          */
+    SUB,            /* r[a] = r[b] - r[c]                          */
+    MUL,            /* r[a] = r[b] * r[c]                          */
+    DIV,            /* r[a] = r[b] / r[c], DIVIDE BY ZERO if 0     */
+    SHL,            /* r[a] = r[b] * 2^c                           */
+    DIV_SHIFT,      /* r[a] = r[b] / 2^c                           */
+    PRINT,          /* print r[a]                                  */
+    EXEC,           /* statements[a]->execute(state)               */
+    JUMP,           /* pc = c                                      */
+    JUMP_LT,        /* if (r[a] < r[b]) pc = c                     */
+    JUMP_GT,        /* if (r[a] > r[b]) pc = c                     */
+    JUMP_EQ,        /* if (r[a] == r[b]) pc = c                    */
+    FAIL,           /* error(messages[a])                          */
+    HALT            /* stop the program                            */
+};
+
+struct Instruction {
+    Opcode op;
+    int a, b, c;
+};
+
+/*
+ * Class: Bytecode
+ * ---------------
+ * A compiled program.  The Statement pointers used by EXEC belong to the
+ * Program the code was compiled from and are only valid until one of its
+ * lines changes.
+ */
+
+struct Bytecode {
+    std::vector<Instruction> code;
+    std::vector<std::string> messages;
+    std::vector<Statement *> statements;
+    int registers = 0;
+};
+
+/*
+ * Class: Compiler
+ * ---------------
+ * Lowers parsed lines into a Bytecode.  The client passes the index of
+ * its lines, which maps each line number to the line's position, calls
+ * beginLine for each line in that order, lets the statement emit its
+ * code with Statement::compile, and finally calls finish, which patches
+ * the jumps.
+ */
+
+class Compiler {
+
+public:
+
+    Compiler(Bytecode &out, const std::unordered_map<int, int> &lineIndex);
+
+/*
+ * Method: beginLine
+ * Usage: compiler.beginLine(index);
+ * ---------------------------------
+ * Marks the start of the code for the line at the given position; jumps
+ * to that line land on the next instruction emitted.
+ */
+
+    void beginLine(int index);
+
+/*
+ * Method: finish
+ * Usage: compiler.finish();
+ * -------------------------
+ * Ends the program with HALT and resolves every jump.  Jumps to lines
+ * that do not exist are sent to a FAIL reporting LINE NUMBER ERROR, so
+ * the error is raised only if such a jump is actually taken.
+ */
+
+    void finish();
+
+/*
+ * Methods: emit, emitJump, emitFail, emitExec
+ * -------------------------------------------
+ * Append one instruction.  emitJump takes a BASIC line number as its
+ * target, emitFail the text of the error, and emitExec a statement to
+ * be run by calling its execute method.
+ */
+
+    void emit(Opcode op, int a = 0, int b = 0, int c = 0);
+    void emitJump(Opcode op, int lineNumber, int a = 0, int b = 0);
+    void emitFail(const std::string &msg);
+    void emitExec(Statement *stmt);
+
+/*
+ * Method: compileExp
+ * Usage: compiler.compileExp(exp, reg);
+ * -------------------------------------
+ * Emits the code that evaluates exp into register reg, using only the
+ * registers above reg as scratch space.  Subexpressions are evaluated
+ * left to right, so errors surface in the same order as with eval.
+ */
+
+    void compileExp(Expression *exp, int reg);
+
+private:
+
+    void useRegister(int reg);
+
+    Bytecode &out;
+    const std::unordered_map<int, int> &lineIndex;
+    std::vector<int> lineStart;
+    std::vector<std::pair<int, int> > fixups;   /* (instruction, line index or -1) */
+
+};
+
+/*
+ * Function: execute
+ * Usage: execute(code, state);
+ * ----------------------------
+ * Runs compiled code from its first instruction until HALT or an error.
+ */
+
+void execute(const Bytecode &code, EvalState &state);
+
+#endif
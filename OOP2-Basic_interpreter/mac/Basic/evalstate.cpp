@@ -6,56 +6,43 @@
  * methods are simple enough that they need no individual documentation.
  */
 
+#include <map>
 #include <string>
+#include <vector>
 #include "evalstate.h"
-
-#include "../StanfordCPPLib/map.h"
 using namespace std;
 
 /* Implementation of the EvalState class */
 
-static map <string, bool> reserve;
-static bool flag = false;
-
-EvalState::EvalState() {
-    if(!flag) {
-        flag = true;
-        reserve["IF"] = 1;
-        reserve["REM"] = 1;
-        reserve["RUN"] = 1;
-        reserve["LET"] = 1;
-        reserve["END"] = 1;
-        reserve["GOTO"] = 1;
-        reserve["THEN"] = 1;
-        reserve["LIST"] = 1;
-        reserve["QUIT"] = 1;
-        reserve["HELP"] = 1;
-        reserve["INPUT"] = 1;
-        reserve["PRINT"] = 1;
-        reserve["CLEAR"] = 1;
-    }
-}
+static map <string, int> slots;
+static vector <string> names;
+
+EvalState::EvalState() = default;
 
 EvalState::~EvalState() = default;
 
-void EvalState::setValue(string var, int value) {
-    if(reserve[var])
-        error("SYNTAX ERROR");
-    symbolTable.put(var, value);
+int EvalState::slotOf(const string &var) {
+    auto it = slots.find(var);
+    if(it != slots.end())
+        return it->second;
+    names.push_back(var);
+    return slots[var] = (int) names.size() - 1;
 }
 
-int EvalState::getValue(string var) {
-    if(reserve[var])
-        error("SYNTAX ERROR");
-    return symbolTable.get(var);
+const string &EvalState::nameOf(int slot) {
+    return names[slot];
 }
 
-bool EvalState::isDefined(string var) {
-    if(reserve[var])
-        error("SYNTAX ERROR");
-    return symbolTable.containsKey(var);
+void EvalState::setValue(int slot, int value) {
+    if(slot >= (int) values.size()) {
+        values.resize(names.size());
+        defined.resize(names.size());
+    }
+    values[slot] = value;
+    defined[slot] = true;
 }
 
 void EvalState::clear() {
-    symbolTable.clear();
+    values.clear();
+    defined.clear();
 }
@@ -10,7 +10,7 @@
 #define _evalstate_h
 
 #include <string>
-#include "../StanfordCPPLib/map.h"
+#include <vector>
 
 /*
  * Class: EvalState
@@ -19,9 +19,8 @@
  * of the evaluator and contains information from the evaluation
  * environment that the evaluator may need to know.  In this
  * version, the only information maintained by the EvalState class
- * is a symbol table that maps variable names into their values.
- * Several of the exercises, however, require you to include
- * additional information in the EvalState class.
+ * is the values of the variables, indexed by the slot numbers the
+ * parser assigned to their names.
  */
 
 class EvalState {
@@ -46,39 +45,82 @@ public:
 
     ~EvalState();
 
+/*
+ * Method: slotOf
+ * Usage: int slot = EvalState::slotOf(var);
+ * -----------------------------------------
+ * Returns the slot number of the variable named var, assigning the next
+ * free one the first time a name is seen.  Slots are shared by every
+ * EvalState, so the parser can resolve names before any state exists.
+ */
+
+    static int slotOf(const std::string &var);
+
+/*
+ * Method: nameOf
+ * Usage: string var = EvalState::nameOf(slot);
+ * --------------------------------------------
+ * Returns the name of the variable stored in the given slot.
+ */
+
+    static const std::string &nameOf(int slot);
+
 /*
  * Method: setValue
- * Usage: state.setValue(var, value);
- * ----------------------------------
- * Sets the value associated with the specified var.
+ * Usage: state.setValue(slot, value);
+ * -----------------------------------
+ * Sets the value of the variable in the specified slot.
  */
 
-    void setValue(std::string var, int value);
+    void setValue(int slot, int value);
 
 /*
  * Method: getValue
- * Usage: int value = state.getValue(var);
- * ---------------------------------------
- * Returns the value associated with the specified variable.
+ * Usage: int value = state.getValue(slot);
+ * ----------------------------------------
+ * Returns the value of the variable in the specified slot.  The slot is
+ * not checked: callers must first make sure isDefined(slot) is true.
  */
 
-    int getValue(std::string var);
+    int getValue(int slot) const;
 
 /*
  * Method: isDefined
- * Usage: if (state.isDefined(var)) . . .
- * --------------------------------------
- * Returns true if the specified variable is defined.
+ * Usage: if (state.isDefined(slot)) . . .
+ * ---------------------------------------
+ * Returns true if the variable in the specified slot has been assigned.
  */
 
-    bool isDefined(std::string var);
+    bool isDefined(int slot) const;
+
+/*
+ * Method: clear
+ * Usage: state.clear();
+ * ---------------------
+ * Forgets the values of all variables.
+ */
 
     void clear();
 
 private:
 
-    Map<std::string,int> symbolTable;
+    std::vector<int> values;
+    std::vector<bool> defined;
 
 };
 
+/*
+ * The accessors are defined here so that the evaluator and the bytecode
+ * loop can inline them.  isDefined checks the slot against the table;
+ * getValue is a bare array access and relies on that check.
+ */
+
+inline int EvalState::getValue(int slot) const {
+    return values[slot];
+}
+
+inline bool EvalState::isDefined(int slot) const {
+    return slot < (int) defined.size() && defined[slot];
+}
+
 #endif
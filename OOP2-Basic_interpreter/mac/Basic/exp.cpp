@@ -4,6 +4,7 @@
  * This file implements the Expression class and its subclasses.
  */
 
+#include <climits>
 #include <string>
 #include "../StanfordCPPLib/error.h"
 #include "evalstate.h"
@@ -16,7 +17,8 @@ using namespace std;
 /*
  * Implementation notes: the Expression class
  * ------------------------------------------
- * The Expression class declares no instance variables and needs no code.
+ * The Expression class declares no instance variables.  Its allocation
+ * functions hand every node to the arena passed to new.
  */
 
 Expression::Expression() {
@@ -27,6 +29,18 @@ Expression::~Expression() {
    /* Empty */
 }
 
+void *Expression::operator new(size_t size, Arena & arena) {
+   return arena.allocate(size);
+}
+
+void Expression::operator delete(void *p, Arena & arena) {
+   /* Empty */
+}
+
+void Expression::operator delete(void *p) {
+   /* Empty */
+}
+
 /*
  * Implementation notes: the ConstantExp subclass
  * ----------------------------------------------
@@ -51,6 +65,11 @@ ExpressionType ConstantExp::getType() {
    return CONSTANT;
 }
 
+bool ConstantExp::getConstant(int & value) {
+   value = this->value;
+   return true;
+}
+
 int ConstantExp::getValue() {
    return value;
 }
@@ -58,95 +77,208 @@ int ConstantExp::getValue() {
 /*
  * Implementation notes: the IdentifierExp subclass
  * ------------------------------------------------
- * The IdentifierExp subclass declares a single instance variable that
- * stores the name of the variable.  The implementation of eval must
- * look this variable up in the evaluation state.
+ * The IdentifierExp subclass stores only the slot that holds the value
+ * of the variable in the evaluation state; the name is recovered from
+ * the slot when toString asks for it.
  */
 
 IdentifierExp::IdentifierExp(string name) {
-   this->name = name;
+   this->slot = EvalState::slotOf(name);
 }
 
 int IdentifierExp::eval(EvalState & state) {
-   if (!state.isDefined(name))
+   if (!state.isDefined(slot))
       error("VARIABLE NOT DEFINED");
       //error(name + " is undefined");
-   return state.getValue(name);
+   return state.getValue(slot);
 }
 
 string IdentifierExp::toString() {
-   return name;
+   return EvalState::nameOf(slot);
 }
 
 ExpressionType IdentifierExp::getType() {
    return IDENTIFIER;
 }
 
+bool IdentifierExp::getConstant(int & value) {
+   return false;
+}
+
 string IdentifierExp::getName() {
-   return name;
+   return EvalState::nameOf(slot);
+}
+
+int IdentifierExp::getSlot() {
+   return slot;
 }
 
 /*
  * Implementation notes: the CompoundExp subclass
  * ----------------------------------------------
  * The CompoundExp subclass declares instance variables for the operator
- * and the left and right subexpressions.  The implementation of eval 
- * evaluates the subexpressions recursively and then applies the operator.
+ * and the left and right subexpressions.  The constructor also works out
+ * how eval should compute the value, so that eval itself is a single
+ * switch with no string comparisons and nothing to recompute.
+ */
+
+static const char *const OPERATOR_NAMES[] = { "=", "+", "-", "*", "/" };
+
+/*
+ * Function: fold
+ * Usage: if (fold(op, left, right, result)) . . .
+ * -----------------------------------------------
+ * Applies an arithmetic operator to two known values.  It refuses the
+ * cases eval has to report or cannot compute, leaving them for run time.
+ * The arithmetic wraps on overflow, as the hardware does at run time.
+ */
+
+static bool fold(CompoundExp::Operator op, int left, int right, int &result) {
+   unsigned a = left, b = right;
+   switch (op) {
+   case CompoundExp::ADD: result = (int) (a + b); return true;
+   case CompoundExp::SUB: result = (int) (a - b); return true;
+   case CompoundExp::MUL: result = (int) (a * b); return true;
+   case CompoundExp::DIV:
+      if (right == 0 || (right == -1 && left == INT_MIN)) return false;
+      result = left / right;
+      return true;
+   default:
+      return false;
+   }
+}
+
+/*
+ * Function: log2Exact
+ * Usage: int k = log2Exact(value);
+ * --------------------------------
+ * Returns k if value is 2 to the power k for some k > 0, and 0 otherwise.
  */
 
+static int log2Exact(int value) {
+   if (value < 2 || (value & (value - 1)) != 0) return 0;
+   int k = 0;
+   while ((1 << k) != value) k++;
+   return k;
+}
+
 CompoundExp::CompoundExp(string op, Expression *lhs, Expression *rhs) {
-   this->op = op;
    this->lhs = lhs;
    this->rhs = rhs;
-}
+   this->operand = nullptr;
+   this->value = 0;
+   if (op == "=") this->op = ASSIGN;
+   else if (op == "+") this->op = ADD;
+   else if (op == "-") this->op = SUB;
+   else if (op == "*") this->op = MUL;
+   else if (op == "/") this->op = DIV;
+   else error("Illegal operator in expression");
 
-CompoundExp::~CompoundExp() {
-   delete lhs;
-   delete rhs;
+   if (this->op == ASSIGN) {
+      if (lhs->getType() == IDENTIFIER) {
+         form = ASSIGN_VAR;
+         value = ((IdentifierExp *) lhs)->getSlot();
+      } else {
+         form = BAD_ASSIGN;
+      }
+      return;
+   }
+   int left, right;
+   bool leftKnown = lhs->getConstant(left);
+   bool rightKnown = rhs->getConstant(right);
+   if (leftKnown && rightKnown && fold(this->op, left, right, value)) {
+      form = FOLDED;
+      return;
+   }
+   static const Form general[] = { BAD_ASSIGN, SUM, DIFFERENCE, PRODUCT, QUOTIENT };
+   form = general[this->op];
+   if (rightKnown && ((right == 0 && (this->op == ADD || this->op == SUB))
+                      || (right == 1 && (this->op == MUL || this->op == DIV)))) {
+      form = FORWARD;
+      operand = lhs;
+   } else if (leftKnown && ((left == 0 && this->op == ADD) || (left == 1 && this->op == MUL))) {
+      form = FORWARD;
+      operand = rhs;
+   } else if (rightKnown && log2Exact(right) > 0 && (this->op == MUL || this->op == DIV)) {
+      form = this->op == MUL ? SHIFT : DIVIDE_SHIFT;
+      operand = lhs;
+      value = log2Exact(right);
+   } else if (leftKnown && log2Exact(left) > 0 && this->op == MUL) {
+      form = SHIFT;
+      operand = rhs;
+      value = log2Exact(left);
+   }
 }
 
 /*
  * Implementation notes: eval
  * --------------------------
- * The eval method for the compound expression case must check for the
- * assignment operator as a special case.  Unlike the arithmetic operators
- * the assignment operator does not evaluate its left operand.
+ * Assignment does not evaluate its left operand, and the simplified
+ * forms evaluate only the operand that is not a constant; constants
+ * cannot fail, so the errors raised are the same as for the full tree.
+ * A negative dividend is biased by 2^k - 1 before the shift so that
+ * the quotient rounds toward zero, as / does.
  */
 
 int CompoundExp::eval(EvalState & state) {
-   if (op == "=") {
-      if (lhs->getType() != IDENTIFIER) {
-         error("Illegal variable in assignment");
-      }
+   switch (form) {
+   case FOLDED:
+      return value;
+   case FORWARD:
+      return operand->eval(state);
+   case SHIFT:
+      return (int) ((unsigned) operand->eval(state) << value);
+   case DIVIDE_SHIFT: {
+      int x = operand->eval(state);
+      return (x + ((x >> 31) & ((1 << value) - 1))) >> value;
+   }
+   case ASSIGN_VAR: {
       int val = rhs->eval(state);
-      state.setValue(((IdentifierExp *) lhs)->getName(), val);
+      state.setValue(value, val);
       return val;
    }
-   int left = lhs->eval(state);
-   int right = rhs->eval(state);
-   if (op == "+") return left + right;
-   if (op == "-") return left - right;
-   if (op == "*") return left * right;
-   if (op == "/")
-   {
-      if(right == 0)
+   case BAD_ASSIGN:
+      error("Illegal variable in assignment");
+      return 0;
+   case SUM: {
+      int left = lhs->eval(state);
+      return left + rhs->eval(state);
+   }
+   case DIFFERENCE: {
+      int left = lhs->eval(state);
+      return left - rhs->eval(state);
+   }
+   case PRODUCT: {
+      int left = lhs->eval(state);
+      return left * rhs->eval(state);
+   }
+   case QUOTIENT: {
+      int left = lhs->eval(state);
+      int right = rhs->eval(state);
+      if (right == 0)
          error("DIVIDE BY ZERO");
       return left / right;
    }
-   error("Illegal operator in expression");
+   }
    return 0;
 }
 
 string CompoundExp::toString() {
-   return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+   return '(' + lhs->toString() + ' ' + getOp() + ' ' + rhs->toString() + ')';
 }
 
 ExpressionType CompoundExp::getType() {
    return COMPOUND;
 }
 
+bool CompoundExp::getConstant(int & value) {
+   if (form != FOLDED) return false;
+   value = this->value;
+   return true;
+}
+
 string CompoundExp:: getOp() {
-   return op;
+   return OPERATOR_NAMES[op];
 }
 
 Expression *CompoundExp::getLHS() {
@@ -156,3 +288,19 @@ Expression *CompoundExp::getLHS() {
 Expression *CompoundExp::getRHS() {
    return rhs;
 }
+
+CompoundExp::Operator CompoundExp::getOperator() {
+   return op;
+}
+
+CompoundExp::Form CompoundExp::getForm() {
+   return form;
+}
+
+Expression *CompoundExp::getOperand() {
+   return operand;
+}
+
+int CompoundExp::getValue() {
+   return value;
+}
@@ -9,6 +9,8 @@
 #ifndef _exp_h
 #define _exp_h
 
+#include <cstddef>
+#include "arena.h"
 #include "evalstate.h"
 
 /*
@@ -58,15 +60,27 @@ public:
 
 /*
  * Destructor: ~Expression
- * Usage: delete exp;
- * ------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting an expression.
+ * ----------------------
+ * Expressions own no storage; their nodes are released all at once
+ * with the arena they were allocated in.  The destructor is virtual
+ * only because the class has virtual methods.
  */
 
    virtual ~Expression();
 
+/*
+ * Operators: new, delete
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
+ * -------------------------------------------------------
+ * Expressions are created only in an Arena, which owns them.  Deleting
+ * one does nothing; the placement form of delete is used only if a
+ * constructor throws.
+ */
+
+   static void *operator new(std::size_t size, Arena & arena);
+   static void operator delete(void *p, Arena & arena);
+   static void operator delete(void *p);
+
 /*
  * Method: eval
  * Usage: int value = exp->eval(state);
@@ -96,6 +110,18 @@ public:
 
    virtual ExpressionType getType() = 0;
 
+/*
+ * Method: getConstant
+ * Usage: if (exp->getConstant(value)) . . .
+ * -----------------------------------------
+ * Returns true if the value of this expression is known without
+ * evaluating it, in which case the value is stored in the argument.
+ * That holds for a ConstantExp and for a CompoundExp built only from
+ * constants, unless evaluating it would raise an error.
+ */
+
+   virtual bool getConstant(int & value) = 0;
+
 };
 
 /*
@@ -110,8 +136,8 @@ public:
 
 /*
  * Constructor: ConstantExp
- * Usage: Expression *exp = new ConstantExp(value);
- * ------------------------------------------------
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
+ * --------------------------------------------------------
  * The constructor initializes a new integer constant expression
  * to the given value.
  */
@@ -128,6 +154,7 @@ public:
    virtual int eval(EvalState & state);
    virtual std::string toString();
    virtual ExpressionType getType();
+   virtual bool getConstant(int & value);
 
 /*
  * Method: getValue
@@ -157,8 +184,8 @@ public:
 
 /*
  * Constructor: IdentifierExp
- * Usage: Expression *exp = new IdentifierExp(name);
- * -------------------------------------------------
+ * Usage: Expression *exp = new (arena) IdentifierExp(name);
+ * ---------------------------------------------------------
  * The constructor initializes a new identifier expression
  * for the variable named by name.
  */
@@ -175,6 +202,7 @@ public:
    virtual int eval(EvalState & state);
    virtual std::string toString();
    virtual ExpressionType getType();
+   virtual bool getConstant(int & value);
 
 /*
  * Method: getName
@@ -186,9 +214,19 @@ public:
 
    std::string getName();
 
+/*
+ * Method: getSlot
+ * Usage: int slot = ((IdentifierExp *) exp)->getSlot();
+ * -----------------------------------------------------
+ * Returns the EvalState slot of the variable, which the constructor
+ * looks up once so that eval never searches for the name.
+ */
+
+   int getSlot();
+
 private:
 
-   std::string name;
+   int slot;
 
 };
 
@@ -203,13 +241,46 @@ class CompoundExp: public Expression {
 
 public:
 
+/*
+ * Type: Operator
+ * --------------
+ * The operators a compound expression can apply, decoded from the
+ * operator token once by the constructor.
+ */
+
+   enum Operator { ASSIGN, ADD, SUB, MUL, DIV };
+
+/*
+ * Type: Form
+ * ----------
+ * How eval computes the value, chosen by the constructor from the
+ * operator and whatever is known about the operands:
+ *  FOLDED       -- both operands are constant; the value is getValue()
+ *  FORWARD      -- x + 0, 0 + x, x - 0, x * 1, 1 * x or x / 1; the
+ *                  value is that of getOperand()
+ *  SHIFT        -- x * 2^k or 2^k * x; getOperand() shifted left by k
+ *  DIVIDE_SHIFT -- x / 2^k, as a shift rounding toward zero
+ *  ASSIGN_VAR   -- assignment to the identifier in slot getValue()
+ *  BAD_ASSIGN   -- assignment to anything else, an error when evaluated
+ *  SUM, DIFFERENCE, PRODUCT, QUOTIENT
+ *               -- anything else; both operands are evaluated
+ */
+
+   enum Form {
+      FOLDED, FORWARD, SHIFT, DIVIDE_SHIFT, ASSIGN_VAR, BAD_ASSIGN,
+      SUM, DIFFERENCE, PRODUCT, QUOTIENT
+   };
+
 /*
  * Constructor: CompoundExp
- * Usage: Expression *exp = new CompoundExp(op, lhs, rhs);
- * -------------------------------------------------------
+ * Usage: Expression *exp = new (arena) CompoundExp(op, lhs, rhs);
+ * ---------------------------------------------------------------
  * The constructor initializes a new compound expression
  * which is composed of the operator (op) and the left and
- * right subexpression (lhs and rhs).
+ * right subexpression (lhs and rhs).  The operands are built
+ * first, so choosing the form here simplifies a tree bottom
+ * up as the parser assembles it.  The subexpressions are kept
+ * unchanged, so toString still shows the expression as written.
  */
 
    CompoundExp(std::string op, Expression *lhs, Expression *rhs);
@@ -221,10 +292,10 @@ public:
  * base class and don't require additional documentation.
  */
 
-   virtual ~CompoundExp();
    virtual int eval(EvalState & state);
    virtual std::string toString();
    virtual ExpressionType getType();
+   virtual bool getConstant(int & value);
 
 /*
  * Methods: getOp, getLHS, getRHS
@@ -240,10 +311,27 @@ public:
    Expression *getLHS();
    Expression *getRHS();
 
+/*
+ * Methods: getOperator, getForm, getOperand, getValue
+ * Usage: CompoundExp::Form form = ((CompoundExp *) exp)->getForm();
+ * -----------------------------------------------------------------
+ * These methods return the decoded operator and the form chosen for
+ * eval.  getOperand is the subexpression a FORWARD, SHIFT or
+ * DIVIDE_SHIFT node evaluates, and getValue is the folded value, the
+ * shift count or the variable slot, as listed for Form above.
+ */
+
+   Operator getOperator();
+   Form getForm();
+   Expression *getOperand();
+   int getValue();
+
 private:
 
-   std::string op;
-   Expression *lhs, *rhs;
+   Operator op;
+   Form form;
+   int value;
+   Expression *lhs, *rhs, *operand;
 
 };
 
@@ -5,6 +5,7 @@
  */
 
 #include <iostream>
+#include <set>
 #include <string>
 
 #include "exp.h"
@@ -21,8 +22,8 @@ using namespace std;
  * This code just reads an expression and then checks for extra tokens.
  */
 
-Expression *parseExp(TokenScanner & scanner) {
-   Expression *exp = readE(scanner);
+Expression *parseExp(TokenScanner & scanner, Arena & arena) {
+   Expression *exp = readE(scanner, arena);
    if (scanner.hasMoreTokens()) {
       error("parseExp: Found extra token: " + scanner.nextToken());
    }
@@ -31,8 +32,8 @@ Expression *parseExp(TokenScanner & scanner) {
 
 /*
  * Implementation notes: readE
- * Usage: exp = readE(scanner, prec);
- * ----------------------------------
+ * Usage: exp = readE(scanner, arena, prec);
+ * -----------------------------------------
  * This version of readE uses precedence to resolve the ambiguity in
  * the grammar.  At each recursive level, the parser reads operators and
  * subexpressions until it finds an operator whose precedence is greater
@@ -40,15 +41,15 @@ Expression *parseExp(TokenScanner & scanner) {
  * readE calls itself recursively to read in that subexpression as a unit.
  */
 
-Expression *readE(TokenScanner & scanner, int prec) {
-   Expression *exp = readT(scanner);
+Expression *readE(TokenScanner & scanner, Arena & arena, int prec) {
+   Expression *exp = readT(scanner, arena);
    string token;
    while (true) {
       token = scanner.nextToken();
       int newPrec = precedence(token);
       if (newPrec <= prec) break;
-      Expression *rhs = readE(scanner, newPrec);
-      exp = new CompoundExp(token, exp, rhs);
+      Expression *rhs = readE(scanner, arena, newPrec);
+      exp = new (arena) CompoundExp(token, exp, rhs);
    }
    scanner.saveToken(token);
    return exp;
@@ -61,13 +62,16 @@ Expression *readE(TokenScanner & scanner, int prec) {
  * or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner & scanner) {
+Expression *readT(TokenScanner & scanner, Arena & arena) {
    string token = scanner.nextToken();
    TokenType type = scanner.getTokenType(token);
-   if (type == WORD) return new IdentifierExp(token);
-   if (type == NUMBER) return new ConstantExp(stringToInteger(token));
+   if (type == WORD) {
+      if (isKeyword(token)) error("SYNTAX ERROR");
+      return new (arena) IdentifierExp(token);
+   }
+   if (type == NUMBER) return new (arena) ConstantExp(stringToInteger(token));
    if (token != "(") error("Illegal term in expression");
-   Expression *exp = readE(scanner);
+   Expression *exp = readE(scanner, arena);
    if (scanner.nextToken() != ")") {
       error("Unbalanced parentheses in expression");
    }
@@ -87,3 +91,18 @@ int precedence(string token) {
    if (token == "*" || token == "/") return 3;
    return 0;
 }
+
+/*
+ * Implementation notes: isKeyword
+ * -------------------------------
+ * Names are checked here, once per occurrence in the source, so that the
+ * evaluator never has to look at the name of a variable again.
+ */
+
+bool isKeyword(const string &token) {
+   static const set<string> keywords = {
+      "IF", "REM", "RUN", "LET", "END", "GOTO", "THEN", "LIST",
+      "QUIT", "HELP", "INPUT", "PRINT", "CLEAR"
+   };
+   return keywords.count(token) != 0;
+}
@@ -14,35 +14,36 @@
 
 /*
  * Function: parseExp
- * Usage: Expression *exp = parseExp(scanner);
- * -------------------------------------------
+ * Usage: Expression *exp = parseExp(scanner, arena);
+ * --------------------------------------------------
  * Parses an expression by reading tokens from the scanner, which must
  * be provided by the client.  The scanner should be set to ignore
- * whitespace and to scan numbers.
+ * whitespace and to scan numbers.  Every node of the expression is
+ * allocated in the arena, which owns it.
  */
 
-Expression *parseExp(TokenScanner & scanner);
+Expression *parseExp(TokenScanner & scanner, Arena & arena);
 
 /*
  * Function: readE
- * Usage: Expression *exp = readE(scanner, prec);
- * ----------------------------------------------
+ * Usage: Expression *exp = readE(scanner, arena, prec);
+ * -----------------------------------------------------
  * Returns the next expression from the scanner involving only operators
  * whose precedence is at least prec.  The prec argument is optional and
  * defaults to 0, which means that the function reads the entire expression.
  */
 
-Expression *readE(TokenScanner & scanner, int prec = 0);
+Expression *readE(TokenScanner & scanner, Arena & arena, int prec = 0);
 
 /*
  * Function: readT
- * Usage: Expression *exp = readT(scanner);
- * ----------------------------------------
+ * Usage: Expression *exp = readT(scanner, arena);
+ * -----------------------------------------------
  * Returns the next individual term, which is either a constant, an
  * identifier, or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner & scanner);
+Expression *readT(TokenScanner & scanner, Arena & arena);
 
 /*
  * Function: precedence
@@ -54,4 +55,14 @@ Expression *readT(TokenScanner & scanner);
 
 int precedence(std::string token);
 
+/*
+ * Function: isKeyword
+ * Usage: if (isKeyword(token)) . . .
+ * ----------------------------------
+ * Returns true if the token is one of the BASIC keywords, none of which
+ * may be used as a variable name.
+ */
+
+bool isKeyword(const std::string &token);
+
 #endif
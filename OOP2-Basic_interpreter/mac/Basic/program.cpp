@@ -21,25 +21,31 @@ Program::~Program() {
 }
 
 void Program::clear() {
-    Program::~Program();
+    mp.clear();
+    linked = compiled = false;
 }
 
 void Program::addSourceLine(int lineNumber, string line) {
     mp[lineNumber] = node(lineNumber, std::move(line));
+    linked = compiled = false;
 }
 
 void Program::removeSourceLine(int lineNumber) {
     mp.erase(lineNumber);
+    linked = compiled = false;
 }
 
 string Program::getSourceLine(int lineNumber) {
     return mp[lineNumber].source_line;
 }
 
-void Program::setParsedStatement(int lineNumber, Statement *stmt) {
-    if(mp.count(lineNumber))
-        mp[lineNumber].parsed_sta = stmt;
-    else
+void Program::setParsedStatement(int lineNumber, Statement *stmt, Arena &&nodes) {
+    if(mp.count(lineNumber)) {
+        node &line = mp[lineNumber];
+        line.parsed_sta = stmt;
+        line.nodes = std::move(nodes);
+        linked = compiled = false;
+    } else
         error("LINE NUMBER ERROR");
 }
 
@@ -69,25 +75,75 @@ bool Program::existingLine(int lineNum) {
 void Program::list()
 {
     int st = Program::getFirstLineNumber();
-    while(st > 0)
+    while(st >= 0)
     {
         cout << getSourceLine(st) << endl;
         st = getNextLineNumber(st);
     }
 }
 
+/*
+ * Implementation notes: link
+ * --------------------------
+ * A jump to a missing line is found here, but it is reported only when
+ * the jump is taken: the lines executed before it still run, and a
+ * branch that is never taken is not an error.
+ */
+
+void Program::link()
+{
+    lines.clear();
+    lineIndex.clear();
+    for(auto &line : mp) {
+        lineIndex[line.first] = (int) lines.size();
+        lines.push_back(entry{line.first, line.second.parsed_sta, -1});
+    }
+    for(auto &line : lines) {
+        int target = line.stmt->getTarget();
+        auto it = lineIndex.find(target);
+        if(target != NEXT_LINE && it != lineIndex.end())
+            line.jump = it->second;
+    }
+    linked = true;
+}
+
+void Program::compile()
+{
+    if(!linked)
+        link();
+    Compiler compiler(code, lineIndex);
+    for(size_t i = 0; i < lines.size(); i++) {
+        compiler.beginLine((int) i);
+        lines[i].stmt->compile(compiler);
+    }
+    compiler.finish();
+    compiled = true;
+}
+
 void Program::run(EvalState &state)
 {
+    if(!compiled)
+        compile();
+    execute(code, state);
+}
+
+void Program::interpret(EvalState &state)
+{
+    if(!linked)
+        link();
     try {
-        int num = getFirstLineNumber();
-        while(num > 0) {
-            if(!existingLine(num))
+        size_t pc = 0;
+        while(pc < lines.size()) {
+            const entry &line = lines[pc];
+            int nxt = line.stmt->execute(state);
+            if(nxt == NEXT_LINE)
+                pc++;
+            else if(nxt == END_PROGRAM)
+                break;
+            else if(line.jump < 0)
                 error("LINE NUMBER ERROR");
-            Statement *st = getParsedStatement(num);
-            int nxt = st->execute(state);
-            if(nxt == 0)
-                nxt = getNextLineNumber(num);
-            num = nxt;
+            else
+                pc = line.jump;
         }
     }
     catch(ErrorException &ex) {
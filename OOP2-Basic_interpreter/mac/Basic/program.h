@@ -8,9 +8,14 @@
 #ifndef _program_h
 #define _program_h
 
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "statement.h"
+#include "bytecode.h"
+#include "arena.h"
 using namespace std;
 
 /*
@@ -23,7 +28,9 @@ using namespace std;
  *    line number) that was entered by the user.
  *
  * 2. The parsed representation of that statement, which is a
- *    pointer to a Statement.
+ *    pointer to a Statement.  The statement and its expressions
+ *    live in an Arena owned by the line, so replacing or removing
+ *    the line frees them in one step.
  */
 
 class Program {
@@ -94,15 +101,16 @@ public:
 
 /*
  * Method: setParsedStatement
- * Usage: program.setParsedStatement(lineNumber, stmt);
- * ----------------------------------------------------
+ * Usage: program.setParsedStatement(lineNumber, stmt, std::move(arena));
+ * ----------------------------------------------------------------------
  * Adds the parsed representation of the statement to the statement
- * at the specified line number.  If no such line exists, this
+ * at the specified line number, together with the arena holding its
+ * nodes, which the program takes over.  If no such line exists, this
  * method raises an error.  If a previous parsed representation
  * exists, the memory for that statement is reclaimed.
  */
 
-    void setParsedStatement(int lineNumber, Statement *stmt);
+    void setParsedStatement(int lineNumber, Statement *stmt, Arena &&nodes);
 
 /*
  * Method: getParsedStatement
@@ -159,35 +167,59 @@ public:
  * Usage: program.run(state);
  * --------------------------
  * This command starts program execution beginning at the lowest-numbered line.
+ * The program is compiled to bytecode the first time it is run after one of
+ * its lines has changed, and the compiled code is executed.
  */
 
     void run(EvalState &state);
 
+/*
+ * Method: interpret
+ * Usage: program.interpret(state);
+ * --------------------------------
+ * Runs the program like run, but by calling each statement's execute
+ * method in turn.  This is slower and is kept for debugging the compiler.
+ * It steps through the line table, so moving to the next line or to a
+ * jump target needs no search either.
+ */
+
+    void interpret(EvalState &state);
+
 private:
     struct node
     {
         int lineNum;
         string source_line;
         Statement *parsed_sta;
+        Arena nodes;
 
         explicit node(int num = -1, string line = ""): lineNum(num), source_line(std::move(line)), parsed_sta(nullptr) {}
-        node (const node &rhs): lineNum(rhs.lineNum), source_line(rhs.source_line) {
-            delete parsed_sta;
-            parsed_sta = rhs.parsed_sta;
-        }
-        ~node() {delete parsed_sta;}
-        node& operator= (const node &rhs) {
-            if(this == &rhs)
-                return *this;
-            lineNum = rhs.lineNum;
-            source_line = rhs.source_line;
-            delete parsed_sta;
-            parsed_sta = rhs.parsed_sta;
-            return *this;
-        }
-
     };
     map <int, node> mp;
+
+/*
+ * The line table: the lines in ascending order, each with the position
+ * of the line its statement jumps to (-1 if that line does not exist),
+ * and a hash from line number to position.  It is rebuilt by link the
+ * first time the program runs after a line is added, replaced or
+ * removed, so a running program never searches for a line.
+ */
+
+    struct entry
+    {
+        int lineNum;
+        Statement *stmt;
+        int jump;
+    };
+    vector <entry> lines;
+    unordered_map <int, int> lineIndex;
+    bool linked = false;
+
+    Bytecode code;
+    bool compiled = false;
+
+    void link();
+    void compile();
 // Fill this in with whatever types and instance variables you need
 };
 
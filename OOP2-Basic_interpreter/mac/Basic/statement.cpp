@@ -10,6 +10,9 @@
 #include <string>
 #include "statement.h"
 #include "parser.h"
+#include "bytecode.h"
+
+#include "../StanfordCPPLib/strlib.h"
 
 using namespace std;
 
@@ -19,21 +22,37 @@ Statement::Statement() = default;
 
 Statement::~Statement() = default;
 
+void *Statement::operator new(size_t size, Arena &arena) {
+    return arena.allocate(size);
+}
+
+void Statement::operator delete(void *p, Arena &arena) {}
+
+void Statement::operator delete(void *p) {}
+
+int Statement::getTarget() {return NEXT_LINE;}
+
 Comment::Comment(TokenScanner &scanner) {}
 
 Comment::~Comment() = default;
 
-int Comment::execute(EvalState & state) {return 0;}
+int Comment::execute(EvalState & state) {return NEXT_LINE;}
+
+void Comment::compile(Compiler &compiler) {}
 
 End::End(TokenScanner &scanner) {}
 
 End::~End() = default;
 
-int End::execute(EvalState &state) {return -1;}
+int End::execute(EvalState &state) {return END_PROGRAM;}
 
-Assignment::Assignment(TokenScanner &scanner) {
+void End::compile(Compiler &compiler) {
+    compiler.emit(HALT);
+}
+
+Assignment::Assignment(TokenScanner &scanner, Arena &arena) {
     try {
-        exp = parseExp(scanner);
+        exp = parseExp(scanner, arena);
     }
     catch(ErrorException &ex) {
         error("SYNTAX ERROR");
@@ -41,9 +60,7 @@ Assignment::Assignment(TokenScanner &scanner) {
     }
 }
 
-Assignment::~Assignment() {
-    delete exp;
-}
+Assignment::~Assignment() = default;
 
 int Assignment::execute(EvalState & state) {
     try {
@@ -52,12 +69,16 @@ int Assignment::execute(EvalState & state) {
     catch(ErrorException &ex) {
         throw ex;
     }
-    return 0;
+    return NEXT_LINE;
 }
 
-Print::Print(TokenScanner &scanner) {
+void Assignment::compile(Compiler &compiler) {
+    compiler.compileExp(exp, 0);
+}
+
+Print::Print(TokenScanner &scanner, Arena &arena) {
     try {
-        exp = parseExp(scanner);
+        exp = parseExp(scanner, arena);
     }
     catch(ErrorException &ex) {
         throw ex;
@@ -65,9 +86,7 @@ Print::Print(TokenScanner &scanner) {
     }
 }
 
-Print::~Print() {
-    delete exp;
-}
+Print::~Print() = default;
 
 int Print::execute(EvalState &state) {
     try {
@@ -76,13 +95,19 @@ int Print::execute(EvalState &state) {
     catch(ErrorException &ex) {
         throw ex;
     }
-    return 0;
+    return NEXT_LINE;
+}
+
+void Print::compile(Compiler &compiler) {
+    compiler.compileExp(exp, 0);
+    compiler.emit(PRINT, 0);
 }
 
 Input::Input(TokenScanner &scanner) {
-    var = scanner.nextToken();
-    if (scanner.getTokenType(var) != WORD || scanner.hasMoreTokens())
+    string name = scanner.nextToken();
+    if (scanner.getTokenType(name) != WORD || isKeyword(name) || scanner.hasMoreTokens())
         error("SYNTAX ERROR");
+    var = EvalState::slotOf(name);
 }
 
 Input::~Input() = default;
@@ -118,7 +143,11 @@ int Input::execute(EvalState &state) {
         }
     }
     // TODO: check again
-    return 0;
+    return NEXT_LINE;
+}
+
+void Input::compile(Compiler &compiler) {
+    compiler.emitExec(this);
 }
 
 Transfer::Transfer(TokenScanner &scanner) {
@@ -136,14 +165,28 @@ Transfer::~Transfer() = default;
 
 int Transfer::execute(EvalState &state) {return lineNum;}
 
-Condition::Condition(TokenScanner &scanner) {
+int Transfer::getTarget() {return lineNum;}
+
+void Transfer::compile(Compiler &compiler) {
+    compiler.emitJump(JUMP, lineNum);
+}
+
+Condition::Condition(TokenScanner &scanner, Arena &arena) {
     try {
-        lhs = readE(scanner, precedence("="));
-        op = scanner.nextToken();
-        rhs = readE(scanner, precedence("="));
-        if(scanner.getTokenType(op) != OPERATOR)
+        lhs = readE(scanner, arena, precedence("="));
+        string token = scanner.nextToken();
+        rhs = readE(scanner, arena, precedence("="));
+        if(scanner.getTokenType(token) != OPERATOR)
             error("SYNTAX ERROR");
-        string token = scanner.nextToken();    //THEN
+        if(token == ">")
+            op = GREATER;
+        else if(token == "<")
+            op = LESS;
+        else if(token == "=")
+            op = EQUAL;
+        else
+            op = INVALID;
+        token = scanner.nextToken();    //THEN
         token = scanner.nextToken();
         lineNum = stringToInteger(token);
     }
@@ -155,19 +198,31 @@ Condition::Condition(TokenScanner &scanner) {
 
 Condition::~Condition() = default;
 
+int Condition::getTarget() {return lineNum;}
+
 int Condition::execute(EvalState &state) {
     try {
         int left = lhs->eval(state);
         int right = rhs->eval(state);
-        if(op == ">")
-            return left > right ? lineNum : 0;
-        else if(op == "<")
-            return left < right ? lineNum : 0;
-        else if(op == "=")
-            return left == right ? lineNum : 0;
-        else  error("SYNTAX ERROR");
+        switch(op) {
+            case GREATER: return left > right ? lineNum : NEXT_LINE;
+            case LESS: return left < right ? lineNum : NEXT_LINE;
+            case EQUAL: return left == right ? lineNum : NEXT_LINE;
+            default: error("SYNTAX ERROR"); return NEXT_LINE;
+        }
     }
     catch(ErrorException &ex) {
         throw ex;
     }
 }
+
+void Condition::compile(Compiler &compiler) {
+    compiler.compileExp(lhs, 0);
+    compiler.compileExp(rhs, 1);
+    if(op == INVALID) {
+        compiler.emitFail("SYNTAX ERROR");
+        return;
+    }
+    static const Opcode jumps[] = { JUMP_LT, JUMP_GT, JUMP_EQ };
+    compiler.emitJump(jumps[op], lineNum, 0, 1);
+}
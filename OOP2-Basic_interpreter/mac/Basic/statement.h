@@ -14,9 +14,23 @@
 
 #include "evalstate.h"
 #include "exp.h"
+#include "arena.h"
 #include "../StanfordCPPLib/tokenscanner.h"
 #include "../StanfordCPPLib/error.h"
 
+class Compiler;
+
+/*
+ * Constants: NEXT_LINE, END_PROGRAM
+ * ---------------------------------
+ * The results of Statement::execute other than a line number to jump
+ * to.  Both are negative, so that every line number, 0 included, can be
+ * a jump target.
+ */
+
+const int NEXT_LINE = -2;
+const int END_PROGRAM = -1;
+
 /*
  * Class: Statement
  * ----------------
@@ -43,15 +57,25 @@ public:
 
     /*
      * Destructor: ~Statement
-     * Usage: delete stmt;
-     * -------------------
-     * The destructor deallocates the storage for this expression.
-     * It must be declared virtual to ensure that the correct subclass
-     * destructor is called when deleting a statement.
+     * ----------------------
+     * Like expressions, statements own no storage and are released
+     * with the arena they were allocated in.
      */
 
     virtual ~Statement();
 
+/*
+ * Operators: new, delete
+ * Usage: Statement *stmt = new (arena) Print(scanner, arena);
+ * -----------------------------------------------------------
+ * Statements are created only in an Arena, normally the one that also
+ * holds their expressions, so a whole line is freed in one step.
+ */
+
+    static void *operator new(std::size_t size, Arena &arena);
+    static void operator delete(void *p, Arena &arena);
+    static void operator delete(void *p);
+
 /*
  * Method: execute
  * Usage: stmt->execute(state);
@@ -60,11 +84,35 @@ public:
  * defines its own execute method that implements the necessary
  * operations.  As was true for the expression evaluator, this
  * method takes an EvalState object for looking up variables or
- * controlling the operation of the interpreter.
+ * controlling the operation of the interpreter.  It returns the
+ * number of the line to continue at, NEXT_LINE to go on with the
+ * following line, or END_PROGRAM to stop.
  */
 
     virtual int execute(EvalState & state) = 0;
 
+/*
+ * Method: compile
+ * Usage: stmt->compile(compiler);
+ * -------------------------------
+ * Emits bytecode with the same effect as execute.  A statement that
+ * returns a line number from execute emits a jump to that line, and
+ * one that returns END_PROGRAM emits HALT.
+ */
+
+    virtual void compile(Compiler &compiler) = 0;
+
+/*
+ * Method: getTarget
+ * Usage: int lineNumber = stmt->getTarget();
+ * ------------------------------------------
+ * Returns the line number that execute may return, so that the program
+ * can resolve it before running, or NEXT_LINE if the statement never
+ * jumps.
+ */
+
+    virtual int getTarget();
+
 };
 
 /*
@@ -72,10 +120,9 @@ public:
  * definitions for the individual statement forms.  Each of
  * those subclasses must define a constructor that parses a
  * statement from a scanner and a method called execute,
- * which executes that statement.  If the private data for
- * a subclass includes data allocated on the heap (such as
- * an Expression object), the class implementation must also
- * specify its own destructor method to free that memory.
+ * which executes that statement.  Subclasses that hold an
+ * Expression parse it into the arena passed to the constructor,
+ * which owns it, so none of them has anything to free.
  */
 
 /*
@@ -90,6 +137,7 @@ public:
     explicit Comment(TokenScanner &scanner);
     ~Comment() override;
     int execute(EvalState & state) override;
+    void compile(Compiler &compiler) override;
 
 };
 
@@ -102,9 +150,10 @@ public:
 class Assignment: public Statement {
 
 public:
-    explicit Assignment(TokenScanner &scanner) ;
+    Assignment(TokenScanner &scanner, Arena &arena);
     ~Assignment() override;
     int execute(EvalState & state) override;
+    void compile(Compiler &compiler) override;
 
 private:
     Expression *exp;
@@ -121,9 +170,10 @@ private:
 class Print: public Statement {
 
 public:
-    explicit Print(TokenScanner &scanner);
+    Print(TokenScanner &scanner, Arena &arena);
     ~Print() override;
     int execute(EvalState &state) override;
+    void compile(Compiler &compiler) override;
 
 private:
     Expression *exp;
@@ -143,8 +193,9 @@ public:
     explicit Input(TokenScanner &scanner);
     ~Input() override;
     int execute(EvalState & state) override;
+    void compile(Compiler &compiler) override;
 private:
-    string var;
+    int var;
 };
 
 /*
@@ -162,6 +213,7 @@ public:
     explicit End(TokenScanner &scanner);
     ~End() override;
     int execute(EvalState & state) override;
+    void compile(Compiler &compiler) override;
 };
 
 /*
@@ -179,6 +231,8 @@ public:
     explicit Transfer(TokenScanner &scanner);
     ~Transfer() override;
     int execute(EvalState &state) override;
+    void compile(Compiler &compiler) override;
+    int getTarget() override;
 
 private:
     int lineNum;
@@ -200,13 +254,25 @@ private:
 class Condition: public Statement {
 
 public:
-    explicit Condition(TokenScanner &scanner);
+    Condition(TokenScanner &scanner, Arena &arena);
     ~Condition() override;
     int execute(EvalState &state) override;
+    void compile(Compiler &compiler) override;
+    int getTarget() override;
+
+/*
+ * Type: Comparison
+ * ----------------
+ * The relational operator, decoded from its token by the constructor.
+ * Any operator token other than <, > and = is INVALID, which is a
+ * SYNTAX ERROR when the statement is executed.
+ */
+
+    enum Comparison { LESS, GREATER, EQUAL, INVALID };
 
 private:
     Expression *lhs, *rhs;
-    string op;
+    Comparison op;
     int lineNum;
 };
 
@@ -9,7 +9,7 @@ const string defaultStudentBasic = "../Basic/Basic";
 const string defaultStanderBasic = "../Demo/Basic-Demo-64bit";
 
 
-const int traceCount = 100;
+const int traceCount = 102;
 const string traces[traceCount] = {
   "trace00.txt", "trace01.txt", "trace02.txt", "trace03.txt", "trace04.txt", "trace05.txt", "trace06.txt", "trace07.txt", "trace08.txt", "trace09.txt", 
   "trace10.txt", "trace11.txt", "trace12.txt", "trace13.txt", "trace14.txt", "trace15.txt", "trace16.txt", "trace17.txt", "trace18.txt", "trace19.txt", 
@@ -21,6 +21,7 @@ const string traces[traceCount] = {
   "trace70.txt", "trace71.txt", "trace72.txt", "trace73.txt", "trace74.txt", "trace75.txt", "trace76.txt", "trace77.txt", "trace78.txt", "trace79.txt", 
   "trace80.txt", "trace81.txt", "trace82.txt", "trace83.txt", "trace84.txt", "trace85.txt", "trace86.txt", "trace87.txt", "trace88.txt", "trace89.txt", 
   "trace90.txt", "trace91.txt", "trace92.txt", "trace93.txt", "trace94.txt", "trace95.txt", "trace96.txt", "trace97.txt", "trace98.txt", "trace99.txt", 
+  "trace100.txt", "trace101.txt",
 };
 
 string studentBasic = "";